@@ -75,6 +75,12 @@ private:
         handle_entity_latest();
       } else if (target.starts_with("/api/entity-stats")) {
         handle_entity_stats();
+      } else if (target.starts_with("/api/pool-stats")) {
+        handle_pool_stats();
+      } else if (target.starts_with("/api/writer-stats")) {
+        handle_writer_stats();
+      } else if (target.starts_with("/api/memory-stats")) {
+        handle_memory_stats();
       } else if (target.starts_with("/api/stats")) {
         handle_stats();
       } else if (target.starts_with("/api/sync-progress")) {
@@ -172,7 +178,7 @@ private:
   void handle_sync_state() {
     res_.set(http::field::content_type, "application/json");
     json result = db_.query_json(
-        "SELECT source, entity, cursor_value, cursor_skip, last_sync_at "
+        "SELECT source, entity, cursor_value, cursor_skip, cursor_id, last_sync_at "
         "FROM sync_state ORDER BY last_sync_at DESC");
     res_.result(http::status::ok);
     res_.body() = result.dump();
@@ -184,6 +190,24 @@ private:
     res_.body() = StatsManager::instance().get_all_dump();
   }
 
+  void handle_pool_stats() {
+    res_.set(http::field::content_type, "application/json");
+    res_.result(http::status::ok);
+    res_.body() = StatsManager::instance().get_pool_dump();
+  }
+
+  void handle_writer_stats() {
+    res_.set(http::field::content_type, "application/json");
+    res_.result(http::status::ok);
+    res_.body() = StatsManager::instance().get_writer_dump();
+  }
+
+  void handle_memory_stats() {
+    res_.set(http::field::content_type, "application/json");
+    res_.result(http::status::ok);
+    res_.body() = StatsManager::instance().get_memory_dump();
+  }
+
   void handle_entity_latest() {
     res_.set(http::field::content_type, "application/json");
 
@@ -0,0 +1,152 @@
+// ============================================================================
+// 微基准: 一页 ColumnBatch → DuckDB 落盘 (含游标更新, 单事务)
+//   sql      : 拼 VALUES (...) 文本, DuckDB 词法/解析/规划后写入 (旧路径)
+//   appender : QueryAppender 列式追加 → INSERT…SELECT 合并
+//   每种路径分别测 upsert (ON CONFLICT DO UPDATE) 与 append (纯 INSERT, 仅追加 entity)
+//
+// 用法: bench_ingest [--iters N] [--table NAME] [--rows N[,N...]]
+//   默认 enriched_order_filled, 每批 1000 / 10000 / 100000 行; 每组测量前重建空表, 每批都是新 id
+// ============================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/column_batch.hpp"
+#include "core/database.hpp"
+#include "core/entity_definition.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+std::string hex_string(std::mt19937_64 &rng, int n) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string s = "0x";
+  for (int i = 0; i < n; ++i)
+    s += kHex[rng() & 0xF];
+  return s;
+}
+
+// 按 schema 合成 rows 行; id 由 seq 递增保证跨批不重复
+void synth_batch(ColumnBatch &batch, size_t rows, int64_t &seq, std::mt19937_64 &rng) {
+  const auto *e = batch.entity();
+  int id_col = entities::find_column(e, "id");
+  batch.clear();
+  int64_t ts = 1700000000 + seq / 4;
+  for (size_t r = 0; r < rows; ++r, ++seq) {
+    if (rng() % 4 == 0)
+      ++ts;
+    batch.begin_row();
+    for (size_t c = 0; c < batch.column_count(); ++c) {
+      if (static_cast<int>(c) == id_col) {
+        batch.set_text(c, hex_string(rng, 48) + "_" + std::to_string(seq));
+        continue;
+      }
+      switch (batch.type(c)) {
+      case entities::ColumnType::INT:
+        batch.set_int(c, ts);
+        break;
+      case entities::ColumnType::DECIMAL:
+        batch.set_double(c, static_cast<double>(rng() % 10000) / 10000.0);
+        break;
+      case entities::ColumnType::BIGNUM:
+        batch.set_text(c, std::to_string(rng() % 1000000000));
+        break;
+      case entities::ColumnType::JSON:
+        batch.set_text(c, R"(["1","0"])");
+        break;
+      default:
+        batch.set_text(c, hex_string(rng, 40));
+        break;
+      }
+    }
+    batch.end_row();
+  }
+}
+
+struct Result {
+  double ms_per_batch;
+  double rows_per_sec;
+};
+
+Result run(Database &db, const entities::EntityDef *e, size_t rows, int iters, bool appender, bool append) {
+  db.execute(std::string("DROP TABLE IF EXISTS ") + e->table);
+  db.init_entity(e);
+
+  std::mt19937_64 rng(42);
+  int64_t seq = 0;
+  PageWrite page{e->table, e->columns, ColumnBatch(e), "bench", e->name, {}, append};
+  page.rows.reserve(rows);
+  std::vector<const PageWrite *> pages{&page};
+
+  double total_ms = 0;
+  for (int i = 0; i <= iters; ++i) {
+    synth_batch(page.rows, rows, seq, rng);
+    page.cursor = SyncCursor{page.rows.cell_string(entities::find_column(e, e->order_field), rows - 1), 0, ""};
+    auto t0 = clock_type::now();
+    std::string error;
+    if (!db.atomic_insert_pages(pages, error, appender)) {
+      std::cerr << "insert failed: " << error << std::endl;
+      std::exit(1);
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - t0).count();
+    if (i > 0) // 第一批预热
+      total_ms += static_cast<double>(us) / 1000.0;
+  }
+  double ms = total_ms / iters;
+  return {ms, static_cast<double>(rows) / (ms / 1000.0)};
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int iters = 5;
+  const entities::EntityDef *entity = &entities::EnrichedOrderFilled;
+  std::vector<size_t> sizes = {1000, 10000, 100000};
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+      iters = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--table") == 0 && i + 1 < argc) {
+      entity = entities::find_entity_by_table(argv[++i]);
+      if (!entity) {
+        std::cerr << "unknown table " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+      sizes.clear();
+      for (const char *p = argv[++i]; *p;) {
+        char *end = nullptr;
+        sizes.push_back(static_cast<size_t>(std::strtoull(p, &end, 10)));
+        p = (*end == ',') ? end + 1 : end;
+      }
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--iters N] [--table NAME] [--rows N[,N...]]" << std::endl;
+      return 1;
+    }
+  }
+
+  Database db(":memory:");
+  db.init_sync_state();
+
+  std::printf("%-22s %7s %-7s %12s %12s %12s %12s %8s\n",
+              "table", "rows", "mode", "sql ms", "sql rows/s", "app ms", "app rows/s", "speedup");
+
+  for (size_t rows : sizes) {
+    for (bool append : {false, true}) {
+      auto sql = run(db, entity, rows, iters, false, append);
+      auto app = run(db, entity, rows, iters, true, append);
+      std::printf("%-22s %7zu %-7s %12.2f %12.0f %12.2f %12.0f %7.2fx\n",
+                  entity->table, rows, append ? "append" : "upsert",
+                  sql.ms_per_batch, sql.rows_per_sec, app.ms_per_batch, app.rows_per_sec,
+                  sql.ms_per_batch / app.ms_per_batch);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,165 @@
+// ============================================================================
+// 微基准: GraphQL 页面 → SQL VALUES
+//   dom    : json::parse + EntityDef::to_values (旧路径)
+//   stream : PageDecoder 分片喂入 → ColumnBatch → append_sql_tuples
+//   decode : PageDecoder 分片喂入 → ColumnBatch (不渲染 SQL)
+//
+// 用法: bench_page_decoder [--iters N] [--chunk BYTES] [<table> <page.json>]...
+//   不给页面文件时, 为每个 entity 合成 1000 行的页面
+// ============================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "core/column_batch.hpp"
+#include "core/entity_definition.hpp"
+#include "sync/page_decoder.hpp"
+#include "bench/synth_rows.hpp"
+
+using json = nlohmann::json;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+struct Page {
+  const entities::EntityDef *entity;
+  std::string body;
+};
+
+Page synth_page(const entities::EntityDef *e, int rows) {
+  std::mt19937_64 rng(42);
+  json items = json::array();
+  int64_t ts = 1700000000;
+  for (int i = 0; i < rows; ++i) {
+    if (rng() % 4 == 0)
+      ++ts;
+    items.push_back(synth::synth_row(e, rng, ts));
+  }
+  json page = {{"data", {{e->plural, items}}}};
+  return {e, page.dump()};
+}
+
+std::string read_file(const std::string &path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f.is_open()) {
+    std::cerr << "cannot open " << path << std::endl;
+    std::exit(1);
+  }
+  std::ostringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+std::string insert_prefix(const entities::EntityDef *e) {
+  return std::string("INSERT INTO ") + e->table + " (" + e->columns + ") VALUES ";
+}
+
+// 旧路径: DOM + to_values + 拼接
+size_t run_dom(const Page &p, std::string &sql) {
+  json j = json::parse(p.body);
+  auto &items = j["data"][p.entity->plural];
+  std::vector<std::string> values;
+  values.reserve(items.size());
+  for (const auto &item : items)
+    values.push_back(p.entity->to_values(item));
+  sql = insert_prefix(p.entity);
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0)
+      sql += ", ";
+    sql += "(" + values[i] + ")";
+  }
+  return values.size();
+}
+
+// 新路径: 分片喂入解码器
+size_t run_stream(const Page &p, graphql::PageDecoder &dec, ColumnBatch &batch,
+                  size_t chunk, std::string *sql) {
+  batch.clear();
+  dec.reset();
+  dec.add_target(p.entity->plural, &batch);
+  for (size_t off = 0; off < p.body.size(); off += chunk)
+    dec.feed(p.body.data() + off, std::min(chunk, p.body.size() - off));
+  if (dec.finish() != graphql::PageStatus::OK) {
+    std::cerr << "decode failed for " << p.entity->table << std::endl;
+    std::exit(1);
+  }
+  if (sql) {
+    *sql = insert_prefix(p.entity);
+    batch.append_sql_tuples(*sql);
+  }
+  return batch.size();
+}
+
+template <typename F>
+double time_ns_per_row(int iters, size_t rows, F &&f) {
+  f(); // warm-up
+  auto t0 = clock_type::now();
+  for (int i = 0; i < iters; ++i)
+    f();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - t0).count();
+  return static_cast<double>(ns) / iters / static_cast<double>(rows ? rows : 1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int iters = 50;
+  size_t chunk = 16 * 1024;
+  std::vector<Page> pages;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+      iters = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+      chunk = static_cast<size_t>(std::atol(argv[++i]));
+    } else if (i + 1 < argc) {
+      const auto *e = entities::find_entity_by_table(argv[i]);
+      if (!e) {
+        std::cerr << "unknown table " << argv[i] << std::endl;
+        return 1;
+      }
+      pages.push_back({e, read_file(argv[++i])});
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--iters N] [--chunk BYTES] [<table> <page.json>]..." << std::endl;
+      return 1;
+    }
+  }
+
+  if (pages.empty()) {
+    for (const auto *e : entities::ALL_ENTITIES)
+      pages.push_back(synth_page(e, 1000));
+  }
+
+  std::printf("%-22s %6s %9s %12s %12s %12s %8s\n",
+              "table", "rows", "bytes", "dom ns/row", "stream ns/row", "decode ns/row", "speedup");
+
+  for (const auto &p : pages) {
+    graphql::PageDecoder dec;
+    ColumnBatch batch(p.entity);
+    std::string sql_dom, sql_stream;
+
+    size_t rows = run_dom(p, sql_dom);
+    size_t rows_stream = run_stream(p, dec, batch, chunk, &sql_stream);
+    if (rows != rows_stream) {
+      std::cerr << p.entity->table << ": row mismatch " << rows << " vs " << rows_stream << std::endl;
+      return 1;
+    }
+
+    double dom = time_ns_per_row(iters, rows, [&] { run_dom(p, sql_dom); });
+    double stream = time_ns_per_row(iters, rows, [&] { run_stream(p, dec, batch, chunk, &sql_stream); });
+    double decode = time_ns_per_row(iters, rows, [&] { run_stream(p, dec, batch, chunk, nullptr); });
+
+    std::printf("%-22s %6zu %9zu %12.1f %12.1f %12.1f %7.2fx\n",
+                p.entity->table, rows, p.body.size(), dom, stream, decode, dom / stream);
+  }
+  return 0;
+}
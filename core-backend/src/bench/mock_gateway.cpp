@@ -0,0 +1,82 @@
+// ============================================================================
+// 本地 GraphQL gateway 替身 (独立进程)
+//   core 的 config 设 "gateway": "127.0.0.1:<port>", "gateway_verify": false 即可整条 sync 对着它跑
+//
+// 用法: mock_gateway [--port N] [--rows N] [--table <subgraph>/<table>[=<file.jsonl>]]... <mock 选项>
+//   不给 --table 时: bench/{enriched_order_filled,split,merge,redemption,condition} + pnl/pnl_condition,
+//   每表合成 --rows 行 (默认 100000); 每 10s 打印一次计数
+// ============================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench/mock_gateway.hpp"
+
+int main(int argc, char *argv[]) {
+  unsigned short port = 8443;
+  size_t rows = 100000;
+  std::vector<std::string> specs;
+  mock_gateway::Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      std::cerr << "usage: " << argv[0] << " [--port N] [--rows N] [--table <subgraph>/<table>[=<file.jsonl>]]... "
+                << mock_gateway::Options::kUsage << std::endl;
+      return 1;
+    }
+    if (std::strcmp(argv[i], "--port") == 0)
+      port = static_cast<unsigned short>(std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "--rows") == 0)
+      rows = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+    else if (std::strcmp(argv[i], "--table") == 0)
+      specs.push_back(argv[++i]);
+    else if (options.parse(argv[i], argv[i + 1]))
+      ++i;
+    else {
+      std::cerr << "unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (specs.empty())
+    specs = mock_gateway::Dataset::default_specs();
+
+  mock_gateway::Dataset data;
+  for (const auto &spec : specs) {
+    std::string error;
+    if (!data.add(spec, rows, options, error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+  }
+  for (const auto &[subgraph, t] : data.tables())
+    std::cout << "[Mock] " << subgraph << "/" << t->entity->table << ": " << t->rows.size() << " rows" << std::endl;
+
+  boost::asio::io_context ioc;
+  mock_gateway::Server server(ioc, data, options, port);
+  std::cout << "[Mock] listening on 127.0.0.1:" << server.port() << " (latency " << options.latency_ms << "+"
+            << options.jitter_ms << "ms, 503 " << options.error_rate << ", 429 " << options.throttle_rate
+            << ", bad indexers " << options.bad_indexer_rate << ")" << std::endl;
+
+  boost::asio::steady_timer timer(ioc);
+  std::function<void()> report = [&]() {
+    timer.expires_after(std::chrono::seconds(10));
+    timer.async_wait([&](boost::system::error_code) {
+      const auto &c = server.counters();
+      std::printf("[Mock] requests %lld rows %lld bytes %lld | 503 %lld 429 %lld bad_indexers %lld bad_queries %lld\n",
+                  static_cast<long long>(c.requests), static_cast<long long>(c.rows),
+                  static_cast<long long>(c.bytes), static_cast<long long>(c.errors),
+                  static_cast<long long>(c.throttled), static_cast<long long>(c.bad_indexers),
+                  static_cast<long long>(c.bad_queries));
+      std::fflush(stdout);
+      report();
+    });
+  };
+  report();
+  ioc.run();
+  return 0;
+}
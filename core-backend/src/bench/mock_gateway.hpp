@@ -0,0 +1,779 @@
+#pragma once
+
+// ============================================================================
+// MockGateway - 本地 GraphQL gateway 替身 (Beast + TLS 自签证书)
+//   路由 POST /api/subgraphs/id/<subgraph>, 执行执行器 / 合批 / token 填充构造的查询子集:
+//     [alias:]plural(first, skip, orderBy, orderDirection, where:{f, f_gt/_gte/_lt/_lte/_in/_not, or:[...]}){fields}
+//   数据集: 按 schema 合成, 或加载 JSONL (每行一个 gateway 形态的对象), 按 (order_field, id) 排序
+//   可配置: 基础延时 + 抖动 + 每行耗时, HTTP 503 / 429 / "bad indexers" 错误概率
+//   单线程: Server 与其连接只在传入的 io_context 上运行, 计数器可跨线程读取
+// ============================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "bench/synth_rows.hpp"
+#include "core/entity_definition.hpp"
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define MOCK_FIRST_MAX 1000 // first 上限(与 gateway 一致, 超出报错)
+#define MOCK_SKIP_MAX 5000  // skip 上限(与 gateway 一致, 超出报错)
+#define MOCK_TARGET_PREFIX "/api/subgraphs/id/"
+
+namespace mock_gateway {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace ssl = asio::ssl;
+using tcp = asio::ip::tcp;
+using json = nlohmann::json;
+
+struct Options {
+  int latency_ms = 20;           // 每个请求的基础延时
+  int jitter_ms = 10;            // 额外均匀抖动 [0, jitter_ms]
+  double per_row_us = 2.0;       // 每返回一行的额外延时(模拟 indexer 扫描)
+  double error_rate = 0.0;       // HTTP 503 概率
+  double throttle_rate = 0.0;    // HTTP 429 概率
+  double bad_indexer_rate = 0.0; // 200 + "bad indexers" GraphQL 错误概率
+  uint64_t seed = 1;
+  size_t hot_rows = 0;           // 合成数据: 每表正中放一个该行数的同时间戳块(热点区块), 0 = 无
+
+  // 解析一个命令行参数(flag + value); 不认识返回 false
+  bool parse(const char *flag, const char *value) {
+    if (std::strcmp(flag, "--latency-ms") == 0)
+      latency_ms = std::atoi(value);
+    else if (std::strcmp(flag, "--jitter-ms") == 0)
+      jitter_ms = std::atoi(value);
+    else if (std::strcmp(flag, "--per-row-us") == 0)
+      per_row_us = std::atof(value);
+    else if (std::strcmp(flag, "--error-rate") == 0)
+      error_rate = std::atof(value);
+    else if (std::strcmp(flag, "--throttle-rate") == 0)
+      throttle_rate = std::atof(value);
+    else if (std::strcmp(flag, "--bad-indexer-rate") == 0)
+      bad_indexer_rate = std::atof(value);
+    else if (std::strcmp(flag, "--seed") == 0)
+      seed = std::strtoull(value, nullptr, 10);
+    else if (std::strcmp(flag, "--hot-rows") == 0)
+      hot_rows = static_cast<size_t>(std::strtoull(value, nullptr, 10));
+    else
+      return false;
+    return true;
+  }
+
+  static constexpr const char *kUsage =
+      "[--latency-ms N] [--jitter-ms N] [--per-row-us X] [--error-rate P] [--throttle-rate P] "
+      "[--bad-indexer-rate P] [--seed N] [--hot-rows N]";
+};
+
+struct Counters {
+  std::atomic<int64_t> requests{0};     // 收到的 GraphQL 请求
+  std::atomic<int64_t> rows{0};         // 返回的行
+  std::atomic<int64_t> bytes{0};        // 响应 body 字节
+  std::atomic<int64_t> errors{0};       // 503
+  std::atomic<int64_t> throttled{0};    // 429
+  std::atomic<int64_t> bad_indexers{0}; // bad indexers 错误
+  std::atomic<int64_t> bad_queries{0};  // 解析/执行失败的查询
+};
+
+// ============================================================================
+// 取值与比较: 与 graph-node 一致, BigInt 按数值比较, 其余按字符串
+// ============================================================================
+
+inline bool is_integer(const std::string &s) {
+  if (s.empty())
+    return false;
+  size_t i = (s[0] == '-') ? 1 : 0;
+  if (i == s.size())
+    return false;
+  for (; i < s.size(); ++i)
+    if (s[i] < '0' || s[i] > '9')
+      return false;
+  return true;
+}
+
+inline int compare_values(const std::string &a, const std::string &b) {
+  if (is_integer(a) && is_integer(b) && a[0] != '-' && b[0] != '-') {
+    if (a.size() != b.size())
+      return a.size() < b.size() ? -1 : 1;
+  }
+  int c = a.compare(b);
+  return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+// 行字段 → 可比较的字符串(引用取 .id); 缺失或 null 返回 nullopt
+inline std::optional<std::string> field_value(const json &row, const std::string &field) {
+  auto it = row.find(field);
+  if (it == row.end() || it->is_null())
+    return std::nullopt;
+  if (it->is_string())
+    return it->get<std::string>();
+  if (it->is_object() && it->contains("id"))
+    return (*it)["id"].get<std::string>();
+  return it->dump();
+}
+
+// ============================================================================
+// 数据集
+// ============================================================================
+struct Table {
+  const entities::EntityDef *entity = nullptr;
+  std::vector<json> rows;         // 按 (order_field, id) 升序
+  std::vector<std::string> dumps; // rows[i].dump(): 全字段查询直接拼接
+  std::unordered_map<std::string, size_t> by_id;
+
+  void finalize() {
+    std::string order = entity->order_field;
+    std::sort(rows.begin(), rows.end(), [&](const json &a, const json &b) {
+      int c = compare_values(field_value(a, order).value_or(""), field_value(b, order).value_or(""));
+      if (c != 0)
+        return c < 0;
+      return a["id"].get<std::string>() < b["id"].get<std::string>();
+    });
+    dumps.clear();
+    by_id.clear();
+    dumps.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      dumps.push_back(rows[i].dump());
+      by_id[rows[i]["id"].get<std::string>()] = i;
+    }
+  }
+};
+
+class Dataset {
+public:
+  // "<subgraph>/<table>" 合成 rows 行, "<subgraph>/<table>=<file.jsonl>" 加载记录的数据
+  bool add(const std::string &spec, size_t rows, const Options &options, std::string &error) {
+    auto slash = spec.find('/');
+    auto eq = spec.find('=');
+    if (slash == std::string::npos || (eq != std::string::npos && eq < slash)) {
+      error = "expected <subgraph>/<table>[=<file.jsonl>]: " + spec;
+      return false;
+    }
+    std::string subgraph = spec.substr(0, slash);
+    std::string table = spec.substr(slash + 1, eq == std::string::npos ? std::string::npos : eq - slash - 1);
+    const auto *e = entities::find_entity_by_table(table.c_str());
+    if (!e) {
+      error = "unknown table " + table;
+      return false;
+    }
+    Table &t = subgraphs_[subgraph][e->plural];
+    t.entity = e;
+    t.rows.clear();
+    if (eq == std::string::npos) {
+      synthesize(t, rows, options.seed, options.hot_rows);
+    } else if (!load_jsonl(t, spec.substr(eq + 1), error)) {
+      return false;
+    }
+    t.finalize();
+    return true;
+  }
+
+  const Table *find(const std::string &subgraph, const std::string &plural) const {
+    auto s = subgraphs_.find(subgraph);
+    if (s == subgraphs_.end())
+      return nullptr;
+    auto t = s->second.find(plural);
+    return t == s->second.end() ? nullptr : &t->second;
+  }
+
+  bool has_subgraph(const std::string &subgraph) const { return subgraphs_.contains(subgraph); }
+
+  // 全部 (subgraph, 表)
+  std::vector<std::pair<std::string, const Table *>> tables() const {
+    std::vector<std::pair<std::string, const Table *>> out;
+    for (const auto &[subgraph, by_plural] : subgraphs_)
+      for (const auto &[plural, t] : by_plural)
+        out.emplace_back(subgraph, &t);
+    return out;
+  }
+
+  // 未指定数据时的默认数据集: 主 subgraph 的事件表 + condition, PnL subgraph 的 pnl_condition
+  static std::vector<std::string> default_specs() {
+    return {"bench/enriched_order_filled", "bench/split", "bench/merge", "bench/redemption",
+            "bench/condition", "pnl/pnl_condition"};
+  }
+
+private:
+  // 时间戳从 1700000000 起, 平均每 4 行进一秒(同一时间戳多行, 覆盖 keyset 边界续接);
+  // hot_rows > 0 时正中 hot_rows 行共用一个时间戳(结算区块式的热点)
+  static void synthesize(Table &t, size_t rows, uint64_t seed, size_t hot_rows) {
+    std::mt19937_64 rng(seed ^ std::hash<std::string>{}(t.entity->table));
+    int64_t ts = 1700000000;
+    t.rows.reserve(rows);
+    size_t hot_begin = rows / 2 - std::min(rows / 2, hot_rows / 2);
+    for (size_t i = 0; i < rows; ++i) {
+      bool hot = i > hot_begin && i < hot_begin + hot_rows;
+      if (rng() % 4 == 0 && !hot)
+        ++ts;
+      t.rows.push_back(synth::synth_row(t.entity, rng, ts));
+    }
+  }
+
+  static bool load_jsonl(Table &t, const std::string &path, std::string &error) {
+    std::ifstream f(path);
+    if (!f.is_open()) {
+      error = "cannot open " + path;
+      return false;
+    }
+    std::string line;
+    while (std::getline(f, line)) {
+      if (line.empty())
+        continue;
+      auto row = json::parse(line, nullptr, false);
+      if (row.is_discarded() || !row.is_object() || !row.contains("id")) {
+        error = "bad row in " + path + ": " + line.substr(0, 80);
+        return false;
+      }
+      t.rows.push_back(std::move(row));
+    }
+    return true;
+  }
+
+  std::map<std::string, std::map<std::string, Table>> subgraphs_; // subgraph → plural → table
+};
+
+// ============================================================================
+// 查询解析: 执行器构造的 GraphQL 子集(无变量/片段/指令)
+//   数字/字符串/枚举名统一成 json 字符串, 列表 → 数组, 对象 → 对象
+// ============================================================================
+struct Selection {
+  std::string alias; // 响应 key (无别名时 = name)
+  std::string name;  // 复数 entity 名
+  json args = json::object();
+  std::vector<std::string> fields; // 顶层字段名(引用字段的子选择忽略)
+};
+
+class QueryParser {
+public:
+  explicit QueryParser(std::string_view q) : q_(q) {}
+
+  bool parse(std::vector<Selection> &out, std::string &error) {
+    skip_ws();
+    if (q_.substr(pos_, 5) == "query") {
+      pos_ += 5;
+      skip_ws();
+    }
+    if (!expect('{'))
+      return fail(error, "expected '{'");
+    while (skip_ws(), pos_ < q_.size() && q_[pos_] != '}') {
+      Selection s;
+      s.name = ident();
+      if (s.name.empty())
+        return fail(error, "expected field name");
+      skip_ws();
+      if (peek(':')) {
+        ++pos_;
+        skip_ws();
+        s.alias = std::move(s.name);
+        s.name = ident();
+      }
+      if (s.alias.empty())
+        s.alias = s.name;
+      skip_ws();
+      if (peek('(')) {
+        ++pos_;
+        while (skip_ws(), pos_ < q_.size() && q_[pos_] != ')') {
+          std::string key = ident();
+          skip_ws();
+          if (key.empty() || !expect(':'))
+            return fail(error, "bad argument");
+          json v;
+          if (!value(v))
+            return fail(error, "bad value for " + key);
+          s.args[key] = std::move(v);
+        }
+        if (!expect(')'))
+          return fail(error, "expected ')'");
+      }
+      skip_ws();
+      if (!peek('{') || !fields(s.fields))
+        return fail(error, "expected selection set for " + s.name);
+      out.push_back(std::move(s));
+    }
+    if (!expect('}'))
+      return fail(error, "expected '}'");
+    return true;
+  }
+
+private:
+  static bool fail(std::string &error, std::string msg) {
+    error = std::move(msg);
+    return false;
+  }
+
+  void skip_ws() {
+    while (pos_ < q_.size() && (q_[pos_] == ' ' || q_[pos_] == ',' || q_[pos_] == '\n' || q_[pos_] == '\t' ||
+                                q_[pos_] == '\r'))
+      ++pos_;
+  }
+
+  bool peek(char c) const { return pos_ < q_.size() && q_[pos_] == c; }
+
+  bool expect(char c) {
+    skip_ws();
+    if (!peek(c))
+      return false;
+    ++pos_;
+    return true;
+  }
+
+  std::string ident() {
+    size_t start = pos_;
+    while (pos_ < q_.size() && (std::isalnum(static_cast<unsigned char>(q_[pos_])) || q_[pos_] == '_'))
+      ++pos_;
+    return std::string(q_.substr(start, pos_ - start));
+  }
+
+  bool value(json &out) {
+    skip_ws();
+    if (pos_ >= q_.size())
+      return false;
+    char c = q_[pos_];
+    if (c == '"') {
+      std::string s;
+      for (++pos_; pos_ < q_.size() && q_[pos_] != '"'; ++pos_) {
+        if (q_[pos_] == '\\' && pos_ + 1 < q_.size())
+          ++pos_;
+        s += q_[pos_];
+      }
+      if (!peek('"'))
+        return false;
+      ++pos_;
+      out = std::move(s);
+      return true;
+    }
+    if (c == '[') {
+      ++pos_;
+      out = json::array();
+      while (skip_ws(), pos_ < q_.size() && q_[pos_] != ']') {
+        json v;
+        if (!value(v))
+          return false;
+        out.push_back(std::move(v));
+      }
+      return expect(']');
+    }
+    if (c == '{') {
+      ++pos_;
+      out = json::object();
+      while (skip_ws(), pos_ < q_.size() && q_[pos_] != '}') {
+        std::string key = ident();
+        if (key.empty() || !expect(':'))
+          return false;
+        json v;
+        if (!value(v))
+          return false;
+        out[key] = std::move(v);
+      }
+      return expect('}');
+    }
+    size_t start = pos_;
+    while (pos_ < q_.size() && (std::isalnum(static_cast<unsigned char>(q_[pos_])) || q_[pos_] == '_' ||
+                                q_[pos_] == '-' || q_[pos_] == '.'))
+      ++pos_;
+    if (start == pos_)
+      return false;
+    out = std::string(q_.substr(start, pos_ - start));
+    return true;
+  }
+
+  // { a b { id } c } → [a, b, c]
+  bool fields(std::vector<std::string> &out) {
+    if (!expect('{'))
+      return false;
+    while (skip_ws(), pos_ < q_.size() && q_[pos_] != '}') {
+      std::string name = ident();
+      if (name.empty())
+        return false;
+      out.push_back(std::move(name));
+      skip_ws();
+      if (peek('{')) {
+        std::vector<std::string> nested;
+        if (!fields(nested))
+          return false;
+      }
+    }
+    return expect('}');
+  }
+
+  std::string_view q_;
+  size_t pos_ = 0;
+};
+
+// ============================================================================
+// 查询执行
+// ============================================================================
+
+// where 子句: 字段等值 / _gt _gte _lt _lte _in _not _not_in, 以及 or / and 列表
+inline bool matches(const json &where, const json &row) {
+  static constexpr std::pair<const char *, int> kOps[] = {
+      {"_not_in", 6}, {"_gte", 2}, {"_lte", 4}, {"_gt", 1}, {"_lt", 3}, {"_in", 5}, {"_not", 7}};
+  for (const auto &[key, cond] : where.items()) {
+    if (key == "or" || key == "and") {
+      bool any = false, all = true;
+      for (const auto &sub : cond) {
+        bool m = matches(sub, row);
+        any = any || m;
+        all = all && m;
+      }
+      if (key == "or" ? !any : !all)
+        return false;
+      continue;
+    }
+    std::string field = key;
+    int op = 0; // 0 = 等值
+    for (const auto &[suffix, code] : kOps) {
+      size_t n = std::strlen(suffix);
+      if (key.size() > n && key.compare(key.size() - n, n, suffix) == 0) {
+        field = key.substr(0, key.size() - n);
+        op = code;
+        break;
+      }
+    }
+    auto v = field_value(row, field);
+    if (op == 5 || op == 6) {
+      bool in = false;
+      for (const auto &x : cond)
+        in = in || (v && *v == x.get<std::string>());
+      if ((op == 5) != in)
+        return false;
+      continue;
+    }
+    if (!v)
+      return op == 7;
+    int c = compare_values(*v, cond.get<std::string>());
+    bool ok = op == 0 ? c == 0 : op == 1 ? c > 0 : op == 2 ? c >= 0 : op == 3 ? c < 0 : op == 4 ? c <= 0 : c != 0;
+    if (!ok)
+      return false;
+  }
+  return true;
+}
+
+// where 对排序字段的下界(等值 / _gt / _gte; or 取各分支最小); 无下界返回 nullopt
+inline std::optional<std::string> lower_bound_of(const json &where, const std::string &order) {
+  std::optional<std::string> lo;
+  for (const char *suffix : {"", "_gt", "_gte"}) {
+    auto it = where.find(order + suffix);
+    if (it != where.end() && (!lo || compare_values(it->get<std::string>(), *lo) < 0))
+      lo = it->get<std::string>();
+  }
+  if (lo)
+    return lo;
+  auto it = where.find("or");
+  if (it == where.end() || it->empty())
+    return std::nullopt;
+  for (const auto &sub : *it) {
+    auto b = lower_bound_of(sub, order);
+    if (!b)
+      return std::nullopt;
+    if (!lo || compare_values(*b, *lo) < 0)
+      lo = b;
+  }
+  return lo;
+}
+
+// 执行一个 selection, 结果数组文本追加到 out; 返回行数, 参数越界等返回 -1 并写入 error
+inline int64_t run_selection(const Table &t, const Selection &s, std::string &out, std::string &error) {
+  auto arg = [&](const char *k, const std::string &def) {
+    auto it = s.args.find(k);
+    return it == s.args.end() ? def : it->get<std::string>();
+  };
+  int first = std::atoi(arg("first", "100").c_str());
+  int skip = std::atoi(arg("skip", "0").c_str());
+  if (first < 0 || first > MOCK_FIRST_MAX) {
+    error = "The `first` argument must be between 0 and " + std::to_string(MOCK_FIRST_MAX) + ", but is " +
+            std::to_string(first);
+    return -1;
+  }
+  if (skip < 0 || skip > MOCK_SKIP_MAX) {
+    error = "The `skip` argument must be between 0 and " + std::to_string(MOCK_SKIP_MAX) + ", but is " +
+            std::to_string(skip);
+    return -1;
+  }
+  std::string order = arg("orderBy", "id");
+  bool desc = arg("orderDirection", "asc") == "desc";
+  json where = s.args.contains("where") ? s.args["where"] : json::object();
+
+  // 候选行: id_in 走索引; 按表序升序时从下界二分起扫并在取满后停止; 否则全表过滤后排序
+  std::vector<size_t> hits;
+  bool sorted = false;
+  if (where.contains("id_in")) {
+    for (const auto &id : where["id_in"]) {
+      auto it = t.by_id.find(id.get<std::string>());
+      if (it != t.by_id.end() && matches(where, t.rows[it->second]))
+        hits.push_back(it->second);
+    }
+  } else if (order == t.entity->order_field && !desc) {
+    size_t i = 0;
+    if (auto lo = lower_bound_of(where, order)) {
+      auto it = std::lower_bound(t.rows.begin(), t.rows.end(), *lo, [&](const json &row, const std::string &v) {
+        return compare_values(field_value(row, order).value_or(""), v) < 0;
+      });
+      i = static_cast<size_t>(it - t.rows.begin());
+    }
+    for (size_t want = static_cast<size_t>(first + skip); i < t.rows.size() && hits.size() < want; ++i)
+      if (matches(where, t.rows[i]))
+        hits.push_back(i);
+    sorted = true;
+  } else {
+    for (size_t i = 0; i < t.rows.size(); ++i)
+      if (matches(where, t.rows[i]))
+        hits.push_back(i);
+  }
+  if (!sorted) {
+    std::stable_sort(hits.begin(), hits.end(), [&](size_t a, size_t b) {
+      int c = compare_values(field_value(t.rows[a], order).value_or(""), field_value(t.rows[b], order).value_or(""));
+      if (c == 0)
+        c = t.rows[a]["id"].get<std::string>().compare(t.rows[b]["id"].get<std::string>());
+      return desc ? c > 0 : c < 0;
+    });
+  }
+
+  // 请求了 schema 的全部字段时直接用预序列化的行
+  bool full = true;
+  for (const auto &col : t.entity->schema)
+    full = full && std::find(s.fields.begin(), s.fields.end(), col.field) != s.fields.end();
+  full = full && s.fields.size() == t.entity->schema.size();
+
+  out += '[';
+  int64_t n = 0;
+  for (size_t k = static_cast<size_t>(skip); k < hits.size() && n < first; ++k, ++n) {
+    if (n > 0)
+      out += ',';
+    if (full) {
+      out += t.dumps[hits[k]];
+      continue;
+    }
+    json obj = json::object();
+    for (const auto &f : s.fields) {
+      auto it = t.rows[hits[k]].find(f);
+      obj[f] = it == t.rows[hits[k]].end() ? json() : *it;
+    }
+    out += obj.dump();
+  }
+  out += ']';
+  return n;
+}
+
+// ============================================================================
+// TLS: 启动时生成自签证书(P-256), 客户端以 verify = false 连接
+// ============================================================================
+inline void use_self_signed_certificate(ssl::context &ctx) {
+  EVP_PKEY *key = EVP_EC_gen("P-256");
+  assert(key && "EC key generation failed");
+  X509 *cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME *name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1,
+                             0);
+  X509_set_issuer_name(cert, name);
+  int signed_len = X509_sign(cert, key, EVP_sha256());
+  assert(signed_len > 0 && "certificate signing failed");
+  int ok = SSL_CTX_use_certificate(ctx.native_handle(), cert) == 1 &&
+           SSL_CTX_use_PrivateKey(ctx.native_handle(), key) == 1;
+  assert(ok && "install certificate failed");
+  (void)signed_len;
+  (void)ok;
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+// ============================================================================
+// Server - 监听 127.0.0.1, 每条连接 keep-alive 循环: 读请求 → 执行 → 延时 → 写响应
+// ============================================================================
+class Server {
+public:
+  Server(asio::io_context &ioc, const Dataset &data, Options options, unsigned short port = 0)
+      : ioc_(ioc), data_(data), options_(options), ssl_ctx_(ssl::context::tls_server), acceptor_(ioc),
+        rng_(options.seed) {
+    use_self_signed_certificate(ssl_ctx_);
+    tcp::endpoint ep(asio::ip::make_address("127.0.0.1"), port);
+    acceptor_.open(ep.protocol());
+    acceptor_.set_option(asio::socket_base::reuse_address(true));
+    acceptor_.bind(ep);
+    acceptor_.listen();
+    do_accept();
+  }
+
+  unsigned short port() const { return acceptor_.local_endpoint().port(); }
+  const Counters &counters() const { return counters_; }
+
+  // 处理一个请求: 返回 (状态码, body, 延时毫秒)
+  struct Reply {
+    http::status status;
+    std::string body;
+    int64_t delay_ms;
+  };
+
+  Reply handle(const http::request<http::string_body> &req) {
+    ++counters_.requests;
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    int64_t delay = options_.latency_ms +
+                    (options_.jitter_ms > 0 ? static_cast<int64_t>(rng_() % (options_.jitter_ms + 1)) : 0);
+
+    double roll = u(rng_);
+    if (roll < options_.error_rate) {
+      ++counters_.errors;
+      return {http::status::service_unavailable, "upstream unavailable", delay};
+    }
+    roll -= options_.error_rate;
+    if (roll < options_.throttle_rate) {
+      ++counters_.throttled;
+      return {http::status::too_many_requests, R"({"errors":[{"message":"Too many requests, try again later"}]})",
+              delay};
+    }
+    roll -= options_.throttle_rate;
+    if (roll < options_.bad_indexer_rate) {
+      ++counters_.bad_indexers;
+      std::string indexers;
+      for (int i = 0; i < 3; ++i)
+        indexers += (i ? ", " : "") + synth::hex_string(rng_, 40) + ": BadResponse(Timeout)";
+      return {http::status::ok,
+              json{{"errors", {{{"message", "bad indexers: {" + indexers + "}"}}}}}.dump(), delay};
+    }
+
+    std::string target(req.target());
+    if (req.method() != http::verb::post || !target.starts_with(MOCK_TARGET_PREFIX) ||
+        !data_.has_subgraph(target.substr(std::strlen(MOCK_TARGET_PREFIX))))
+      return graphql_error("subgraph not found: " + target, delay);
+    std::string subgraph = target.substr(std::strlen(MOCK_TARGET_PREFIX));
+
+    auto body = json::parse(req.body(), nullptr, false);
+    if (body.is_discarded() || !body.contains("query") || !body["query"].is_string())
+      return graphql_error("request body must be {\"query\": ...}", delay);
+
+    std::vector<Selection> selections;
+    std::string error;
+    std::string query = body["query"].get<std::string>();
+    if (!QueryParser(query).parse(selections, error))
+      return graphql_error("query parse error: " + error, delay);
+
+    std::string out = R"({"data":{)";
+    int64_t rows = 0;
+    for (size_t i = 0; i < selections.size(); ++i) {
+      const auto &s = selections[i];
+      const Table *t = data_.find(subgraph, s.name);
+      if (!t)
+        return graphql_error("Type `Query` has no field `" + s.name + "`", delay);
+      out += (i ? "," : "") + json(s.alias).dump() + ":";
+      int64_t n = -1;
+      try {
+        n = run_selection(*t, s, out, error);
+      } catch (const json::exception &e) { // 子集之外的参数形态(如嵌套过滤)
+        error = std::string("unsupported argument: ") + e.what();
+      }
+      if (n < 0)
+        return graphql_error(error, delay);
+      rows += n;
+    }
+    out += "}}";
+    counters_.rows += rows;
+    delay += static_cast<int64_t>(options_.per_row_us * static_cast<double>(rows) / 1000.0);
+    return {http::status::ok, std::move(out), delay};
+  }
+
+private:
+  Reply graphql_error(const std::string &message, int64_t delay) {
+    ++counters_.bad_queries;
+    return {http::status::ok, json{{"errors", {{{"message", message}}}}}.dump(), delay};
+  }
+
+  class Connection : public std::enable_shared_from_this<Connection> {
+  public:
+    Connection(tcp::socket socket, Server &server)
+        : stream_(std::move(socket), server.ssl_ctx_), timer_(server.ioc_), server_(server) {}
+
+    void start() {
+      stream_.async_handshake(ssl::stream_base::server, [self = shared_from_this()](beast::error_code ec) {
+        if (!ec)
+          self->do_read();
+      });
+    }
+
+  private:
+    void do_read() {
+      req_ = {};
+      http::async_read(stream_, buffer_, req_, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+        if (ec)
+          return; // 对端关闭 / 出错: 丢弃连接
+        self->on_request();
+      });
+    }
+
+    void on_request() {
+      auto reply = server_.handle(req_);
+      res_ = {reply.status, req_.version()};
+      res_.set(http::field::content_type, "application/json");
+      res_.keep_alive(req_.keep_alive());
+      res_.body() = std::move(reply.body);
+      res_.prepare_payload();
+      timer_.expires_after(std::chrono::milliseconds(reply.delay_ms));
+      timer_.async_wait([self = shared_from_this()](beast::error_code) { self->do_write(); });
+    }
+
+    void do_write() {
+      server_.counters_.bytes += static_cast<int64_t>(res_.body().size());
+      http::async_write(stream_, res_, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+        if (ec || !self->res_.keep_alive())
+          return;
+        self->do_read();
+      });
+    }
+
+    beast::ssl_stream<beast::tcp_stream> stream_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> req_;
+    http::response<http::string_body> res_;
+    asio::steady_timer timer_;
+    Server &server_;
+  };
+
+  void do_accept() {
+    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+      if (!ec) {
+        socket.set_option(tcp::no_delay(true));
+        std::make_shared<Connection>(std::move(socket), *this)->start();
+      }
+      do_accept();
+    });
+  }
+
+  asio::io_context &ioc_;
+  const Dataset &data_;
+  Options options_;
+  ssl::context ssl_ctx_;
+  tcp::acceptor acceptor_;
+  std::mt19937_64 rng_;
+  Counters counters_;
+};
+
+} // namespace mock_gateway
@@ -0,0 +1,72 @@
+#pragma once
+
+// ============================================================================
+// 基准用合成数据: 按 EntityDef schema 生成与 gateway 返回形态一致的行
+//   (bench_page_decoder 的页面 / mock_gateway 的数据集共用)
+// ============================================================================
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "core/entity_definition.hpp"
+
+namespace synth {
+
+using json = nlohmann::json;
+
+inline std::string hex_string(std::mt19937_64 &rng, int n) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string s = "0x";
+  for (int i = 0; i < n; ++i)
+    s += kHex[rng() & 0xF];
+  return s;
+}
+
+inline std::string digits(std::mt19937_64 &rng, int n) {
+  std::string s(1, static_cast<char>('1' + rng() % 9));
+  for (int i = 1; i < n; ++i)
+    s += static_cast<char>('0' + rng() % 10);
+  return s;
+}
+
+// 按 schema 合成一行 (字段形态与 gateway 返回一致)
+inline json synth_row(const entities::EntityDef *e, std::mt19937_64 &rng, int64_t ts) {
+  json row = json::object();
+  for (const auto &col : e->schema) {
+    std::string f = col.field;
+    switch (col.type) {
+    case entities::ColumnType::TEXT:
+      if (f == "id" && e == &entities::EnrichedOrderFilled)
+        row[f] = hex_string(rng, 64) + "_" + hex_string(rng, 64);
+      else if (f == "side")
+        row[f] = (rng() & 1) ? "Buy" : "Sell";
+      else if (f == "oracle" || f == "stakeholder" || f == "redeemer")
+        row[f] = hex_string(rng, 40);
+      else
+        row[f] = hex_string(rng, 64);
+      break;
+    case entities::ColumnType::REF:
+      row[f] = {{"id", f == "market" ? digits(rng, 77) : hex_string(rng, 40)}};
+      break;
+    case entities::ColumnType::INT:
+      row[f] = (f == "outcomeSlotCount") ? std::string("2") : std::to_string(ts);
+      break;
+    case entities::ColumnType::BIGNUM:
+      row[f] = digits(rng, 9);
+      break;
+    case entities::ColumnType::DECIMAL:
+      row[f] = "0." + digits(rng, 4);
+      break;
+    case entities::ColumnType::JSON:
+      row[f] = (f == "positionIds") ? json::array({digits(rng, 77), digits(rng, 77)})
+                                    : json::array({"1", "0"});
+      break;
+    }
+  }
+  return row;
+}
+
+} // namespace synth
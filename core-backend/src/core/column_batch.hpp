@@ -0,0 +1,350 @@
+#pragma once
+
+// ============================================================================
+// ColumnBatch - 按 entity schema 组织的列式行缓冲
+// 定长列(int64/double)直接存值, 变长列共用一块 arena + offsets, 无逐行 std::string
+// ============================================================================
+
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "entity_definition.hpp"
+
+class ColumnBatch {
+public:
+  ColumnBatch() = default;
+
+  explicit ColumnBatch(const entities::EntityDef *entity) { bind(entity); }
+
+  void bind(const entities::EntityDef *entity) {
+    assert(entity != nullptr);
+    assert(entity->schema.size() <= 64);
+    entity_ = entity;
+    cols_.assign(entity->schema.size(), Column{});
+    for (size_t i = 0; i < cols_.size(); ++i) {
+      cols_[i].type = entity->schema[i].type;
+      cols_[i].offsets.push_back(0);
+    }
+    rows_ = 0;
+    row_mask_ = 0;
+  }
+
+  const entities::EntityDef *entity() const { return entity_; }
+  size_t size() const { return rows_; }
+  bool empty() const { return rows_ == 0; }
+  size_t column_count() const { return cols_.size(); }
+
+  void reserve(size_t rows) {
+    for (auto &c : cols_) {
+      c.nulls.reserve(rows);
+      if (c.type == entities::ColumnType::INT) {
+        c.i64.reserve(rows);
+      } else if (c.type == entities::ColumnType::DECIMAL) {
+        c.f64.reserve(rows);
+      } else {
+        c.offsets.reserve(rows + 1);
+        c.chars.reserve(rows * 48);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto &c : cols_) {
+      c.i64.clear();
+      c.f64.clear();
+      c.chars.clear();
+      c.offsets.assign(1, 0);
+      c.nulls.clear();
+    }
+    rows_ = 0;
+    row_mask_ = 0;
+  }
+
+  // 回滚到前 n 行(解码失败时丢弃半页)
+  void truncate(size_t n) {
+    assert(n <= rows_);
+    for (auto &c : cols_) {
+      c.nulls.resize(n);
+      if (c.type == entities::ColumnType::INT) {
+        c.i64.resize(n);
+      } else if (c.type == entities::ColumnType::DECIMAL) {
+        c.f64.resize(n);
+      } else {
+        c.chars.resize(c.offsets[n]);
+        c.offsets.resize(n + 1);
+      }
+    }
+    rows_ = n;
+    row_mask_ = 0;
+  }
+
+  // 原地压缩: 只保留 keep[r] != 0 的行(保持顺序), keep.size() == size()
+  void retain(const std::vector<uint8_t> &keep) {
+    assert(keep.size() == rows_);
+    for (auto &c : cols_) {
+      size_t w = 0;
+      for (size_t r = 0; r < rows_; ++r) {
+        if (!keep[r])
+          continue;
+        c.nulls[w] = c.nulls[r];
+        if (c.type == entities::ColumnType::INT) {
+          c.i64[w] = c.i64[r];
+        } else if (c.type == entities::ColumnType::DECIMAL) {
+          c.f64[w] = c.f64[r];
+        } else {
+          uint32_t begin = c.offsets[r], len = c.offsets[r + 1] - begin;
+          std::memmove(c.chars.data() + c.offsets[w], c.chars.data() + begin, len);
+          c.offsets[w + 1] = c.offsets[w] + len;
+        }
+        ++w;
+      }
+      c.nulls.resize(w);
+      if (c.type == entities::ColumnType::INT) {
+        c.i64.resize(w);
+      } else if (c.type == entities::ColumnType::DECIMAL) {
+        c.f64.resize(w);
+      } else {
+        c.chars.resize(c.offsets[w]);
+        c.offsets.resize(w + 1);
+      }
+    }
+    size_t kept = 0;
+    for (auto k : keep)
+      kept += k ? 1 : 0;
+    rows_ = kept;
+    row_mask_ = 0;
+  }
+
+  // 追加另一个同 entity 批次的全部行
+  void append(const ColumnBatch &other) {
+    assert(other.entity_ == entity_);
+    for (size_t i = 0; i < cols_.size(); ++i) {
+      auto &c = cols_[i];
+      const auto &o = other.cols_[i];
+      c.nulls.insert(c.nulls.end(), o.nulls.begin(), o.nulls.end());
+      c.i64.insert(c.i64.end(), o.i64.begin(), o.i64.end());
+      c.f64.insert(c.f64.end(), o.f64.begin(), o.f64.end());
+      uint32_t base = static_cast<uint32_t>(c.chars.size());
+      c.chars.append(o.chars);
+      for (size_t r = 1; r < o.offsets.size(); ++r)
+        c.offsets.push_back(base + o.offsets[r]);
+    }
+    rows_ += other.rows_;
+  }
+
+  // ==========================================================================
+  // 逐行写入: begin_row → set_*(任意列序, 每列至多一次) → end_row(缺失列补 NULL)
+  // ==========================================================================
+  void begin_row() { row_mask_ = 0; }
+
+  void set_null(size_t col) {
+    if (!mark(col))
+      return;
+    auto &c = cols_[col];
+    c.nulls.push_back(1);
+    if (c.type == entities::ColumnType::INT)
+      c.i64.push_back(0);
+    else if (c.type == entities::ColumnType::DECIMAL)
+      c.f64.push_back(0.0);
+    else
+      c.offsets.push_back(static_cast<uint32_t>(c.chars.size()));
+  }
+
+  void set_int(size_t col, int64_t v) {
+    if (!mark(col))
+      return;
+    auto &c = cols_[col];
+    assert(c.type == entities::ColumnType::INT);
+    c.nulls.push_back(0);
+    c.i64.push_back(v);
+  }
+
+  void set_double(size_t col, double v) {
+    if (!mark(col))
+      return;
+    auto &c = cols_[col];
+    assert(c.type == entities::ColumnType::DECIMAL);
+    c.nulls.push_back(0);
+    c.f64.push_back(v);
+  }
+
+  void set_text(size_t col, std::string_view v) {
+    if (!mark(col))
+      return;
+    auto &c = cols_[col];
+    assert(!is_fixed(c.type));
+    c.nulls.push_back(0);
+    c.chars.append(v);
+    c.offsets.push_back(static_cast<uint32_t>(c.chars.size()));
+  }
+
+  // 变长列分段写入(JSON 原文捕获): open_text → append_text* → close_text
+  void open_text(size_t col) {
+    bool fresh = mark(col);
+    assert(fresh);
+    (void)fresh;
+    cols_[col].nulls.push_back(0);
+  }
+  void append_text(size_t col, std::string_view v) { cols_[col].chars.append(v); }
+  void append_text(size_t col, char ch) { cols_[col].chars.push_back(ch); }
+  void close_text(size_t col) {
+    auto &c = cols_[col];
+    c.offsets.push_back(static_cast<uint32_t>(c.chars.size()));
+  }
+
+  bool has_value(size_t col) const { return (row_mask_ >> col) & 1; }
+
+  void end_row() {
+    for (size_t i = 0; i < cols_.size(); ++i) {
+      if (!has_value(i))
+        set_null(i);
+    }
+    ++rows_;
+    row_mask_ = 0;
+  }
+
+  // ==========================================================================
+  // 读取
+  // ==========================================================================
+  entities::ColumnType type(size_t col) const { return cols_[col].type; }
+  bool is_null(size_t col, size_t row) const { return cols_[col].nulls[row] != 0; }
+  int64_t get_int(size_t col, size_t row) const { return cols_[col].i64[row]; }
+  double get_double(size_t col, size_t row) const { return cols_[col].f64[row]; }
+  std::string_view get_text(size_t col, size_t row) const {
+    const auto &c = cols_[col];
+    return std::string_view(c.chars).substr(c.offsets[row], c.offsets[row + 1] - c.offsets[row]);
+  }
+
+  // 同列两行是否相等(NULL 与 NULL 相等)
+  bool cell_equals(size_t col, size_t a, size_t b) const {
+    if (is_null(col, a) || is_null(col, b))
+      return is_null(col, a) == is_null(col, b);
+    switch (cols_[col].type) {
+    case entities::ColumnType::INT:
+      return get_int(col, a) == get_int(col, b);
+    case entities::ColumnType::DECIMAL:
+      return get_double(col, a) == get_double(col, b);
+    default:
+      return get_text(col, a) == get_text(col, b);
+    }
+  }
+
+  // 单元格的游标字符串形式(NULL → "")
+  std::string cell_string(size_t col, size_t row) const {
+    if (is_null(col, row))
+      return "";
+    switch (cols_[col].type) {
+    case entities::ColumnType::INT:
+      return std::to_string(get_int(col, row));
+    case entities::ColumnType::DECIMAL: {
+      std::string out;
+      append_double(out, get_double(col, row));
+      return out;
+    }
+    default:
+      return std::string(get_text(col, row));
+    }
+  }
+
+  // 缓冲占用字节(近似)
+  size_t byte_size() const {
+    size_t total = 0;
+    for (const auto &c : cols_) {
+      total += c.nulls.size() + c.i64.size() * sizeof(int64_t) + c.f64.size() * sizeof(double) +
+               c.chars.size() + c.offsets.size() * sizeof(uint32_t);
+    }
+    return total;
+  }
+
+  // ==========================================================================
+  // SQL 渲染: 第 row 行 → "v1,v2,..." (与 EntityDef::to_values 等价)
+  // ==========================================================================
+  void append_sql_values(std::string &out, size_t row) const {
+    for (size_t i = 0; i < cols_.size(); ++i) {
+      if (i > 0)
+        out += ',';
+      if (is_null(i, row)) {
+        out += "NULL";
+        continue;
+      }
+      switch (cols_[i].type) {
+      case entities::ColumnType::INT: {
+        char buf[24];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), get_int(i, row));
+        assert(ec == std::errc{});
+        out.append(buf, end);
+        break;
+      }
+      case entities::ColumnType::DECIMAL:
+        append_double(out, get_double(i, row));
+        break;
+      default:
+        append_sql_quoted(out, get_text(i, row));
+        break;
+      }
+    }
+  }
+
+  // 全部行 → "(...), (...), ..."
+  void append_sql_tuples(std::string &out) const {
+    for (size_t r = 0; r < rows_; ++r) {
+      if (r > 0)
+        out += ", ";
+      out += '(';
+      append_sql_values(out, r);
+      out += ')';
+    }
+  }
+
+private:
+  struct Column {
+    entities::ColumnType type = entities::ColumnType::TEXT;
+    std::vector<int64_t> i64;
+    std::vector<double> f64;
+    std::string chars;             // 变长列 arena
+    std::vector<uint32_t> offsets; // 变长列: 第 r 行 = chars[offsets[r], offsets[r+1])
+    std::vector<uint8_t> nulls;
+  };
+
+  static bool is_fixed(entities::ColumnType t) {
+    return t == entities::ColumnType::INT || t == entities::ColumnType::DECIMAL;
+  }
+
+  // 标记本行 col 已写; 重复字段忽略
+  bool mark(size_t col) {
+    assert(col < cols_.size());
+    uint64_t bit = uint64_t{1} << col;
+    if (row_mask_ & bit)
+      return false;
+    row_mask_ |= bit;
+    return true;
+  }
+
+  static void append_double(std::string &out, double v) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+    assert(ec == std::errc{});
+    out.append(buf, end);
+  }
+
+  static void append_sql_quoted(std::string &out, std::string_view s) {
+    out += '\'';
+    for (char c : s) {
+      if (c == '\'')
+        out += "''";
+      else
+        out += c;
+    }
+    out += '\'';
+  }
+
+  const entities::EntityDef *entity_ = nullptr;
+  std::vector<Column> cols_;
+  size_t rows_ = 0;
+  uint64_t row_mask_ = 0;
+};
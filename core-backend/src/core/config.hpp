@@ -13,18 +13,77 @@ using json = nlohmann::json;
 // 配置结构
 // ============================================================================
 
+// 单个 entity 的同步参数(config 中 entity 写成对象时生效, 否则取默认)
+struct EntityOptions {
+  int pipeline_depth = 2;              // 在途页数上限(已请求未落盘), 1 = 串行
+  int max_page_size = 1000;            // 自适应 first: 的上限(gateway 单页最多 1000)
+  int backfill_shards = 1;             // 冷启动回填的时间分片数(仅 KEYSET 事件表), 1 = 单游标
+  int refresh_shards = 1;              // 全量重拉的 id 前缀分片数(仅 ID 模式), 1 = 按 id_gt 单游标增量
+  int refresh_interval_seconds = 600;  // 全量重拉周期
+  bool hedge = false;                  // 慢页对冲: 超过该 entity 近期 p95 未响应时再发一份
+  int skip_fanout = 1;                 // gte + skip 模式遇到热点时间戳时并发的 skip 页数, 1 = 逐页
+
+  static EntityOptions parse(const json &j) {
+    EntityOptions o;
+    o.pipeline_depth = j.value("pipeline_depth", o.pipeline_depth);
+    o.max_page_size = j.value("max_page_size", o.max_page_size);
+    o.backfill_shards = j.value("backfill_shards", o.backfill_shards);
+    o.refresh_shards = j.value("refresh_shards", o.refresh_shards);
+    o.refresh_interval_seconds = j.value("refresh_interval_seconds", o.refresh_interval_seconds);
+    o.hedge = j.value("hedge", o.hedge);
+    o.skip_fanout = j.value("skip_fanout", o.skip_fanout);
+    assert(o.pipeline_depth >= 1 && "pipeline_depth 必须 >= 1");
+    assert(o.max_page_size >= 1 && o.max_page_size <= 1000 && "max_page_size 必须在 [1, 1000]");
+    assert(o.backfill_shards >= 1 && "backfill_shards 必须 >= 1");
+    assert(o.refresh_shards >= 1 && o.refresh_shards <= 256 && "refresh_shards 必须在 [1, 256]");
+    assert(o.skip_fanout >= 1 && "skip_fanout 必须 >= 1");
+    return o;
+  }
+};
+
+// 单个 gateway API key 的配额(config "api_keys" 写成对象时生效, 否则取默认)
+struct ApiKeyConfig {
+  std::string key;
+  double rate_per_sec = 50.0; // 令牌桶补充速率
+  int burst = 100;            // 令牌桶容量
+  int max_inflight = 64;      // 该 key 在途请求上限(默认同单 key 时的 AIMD 窗口上限)
+
+  static ApiKeyConfig parse(const json &j) {
+    ApiKeyConfig k;
+    if (j.is_string()) {
+      k.key = j.get<std::string>();
+      return k;
+    }
+    k.key = j["key"].get<std::string>();
+    k.rate_per_sec = j.value("rate_per_sec", k.rate_per_sec);
+    k.burst = j.value("burst", k.burst);
+    k.max_inflight = j.value("max_inflight", k.max_inflight);
+    assert(k.rate_per_sec > 0 && "rate_per_sec 必须 > 0");
+    assert(k.burst >= 1 && "burst 必须 >= 1");
+    assert(k.max_inflight >= 1 && "max_inflight 必须 >= 1");
+    return k;
+  }
+};
+
 struct SourceConfig {
   std::string name;
   std::string subgraph_id;
   bool enabled;
+  bool batch = false; // 尾部执行器的分页请求按 GraphQL 别名合批
   std::vector<std::string> entities;
-  std::unordered_map<std::string, std::string> entity_table_map; // entity_name -> table_name
+  std::unordered_map<std::string, std::string> entity_table_map;     // entity_name -> table_name
+  std::unordered_map<std::string, EntityOptions> entity_options_map; // entity_name -> options
 };
 
 struct Config {
-  std::string api_key;
+  std::vector<ApiKeyConfig> api_keys; // "api_keys": ["k1", {"key": "k2", ...}] 或单个 "api_key"
   std::string db_path;
+  std::string gateway;          // "host:port", 空 = gateway.thegraph.com:443 (基准时指向本地 mock_gateway)
+  bool gateway_verify = true;   // false: 接受自签证书(仅本地 mock)
   int sync_interval_seconds;
+  bool continuous = false; // 持续模式: 每个 entity 独立轮询, sync_interval_seconds 为最长轮询间隔
+  std::string archive_dir; // 非空: 成功的响应 body 压缩归档到此目录(可离线重灌)
+  int ingest_memory_mb = 0; // sync 链路内存预算(MB), 0 = INGEST_MEMORY_DEFAULT_MB
   std::vector<SourceConfig> sources;
 
   static Config load(const std::string &path) {
@@ -35,9 +94,21 @@ struct Config {
     f >> j;
 
     Config config;
-    config.api_key = j["api_key"].get<std::string>();
+    if (j.contains("api_keys")) {
+      for (const auto &k : j["api_keys"])
+        config.api_keys.push_back(ApiKeyConfig::parse(k));
+    } else {
+      config.api_keys.push_back(ApiKeyConfig::parse(j["api_key"]));
+    }
+    assert(!config.api_keys.empty() && "至少需要一个 api key");
     config.db_path = j["db_path"].get<std::string>();
+    config.gateway = j.value("gateway", "");
+    config.gateway_verify = j.value("gateway_verify", true);
     config.sync_interval_seconds = j.value("sync_interval_seconds", 60);
+    config.continuous = j.value("continuous", false);
+    config.archive_dir = j.value("archive_dir", "");
+    config.ingest_memory_mb = j.value("ingest_memory_mb", 0);
+    assert(config.ingest_memory_mb >= 0 && "ingest_memory_mb 必须 >= 0");
 
     if (j.contains("sources")) {
       for (auto &[name, source] : j["sources"].items()) {
@@ -45,9 +116,17 @@ struct Config {
         sc.name = name;
         sc.subgraph_id = source["subgraph_id"].get<std::string>();
         sc.enabled = source.value("enabled", true);
-        for (auto &[entity_name, table_name] : source["entities"].items()) {
+        sc.batch = source.value("batch", false);
+        // "Entity": "table" 或 "Entity": {"table": "...", <EntityOptions>}
+        for (auto &[entity_name, entry] : source["entities"].items()) {
           sc.entities.push_back(entity_name);
-          sc.entity_table_map[entity_name] = table_name.get<std::string>();
+          if (entry.is_object()) {
+            sc.entity_table_map[entity_name] = entry["table"].get<std::string>();
+            sc.entity_options_map[entity_name] = EntityOptions::parse(entry);
+          } else {
+            sc.entity_table_map[entity_name] = entry.get<std::string>();
+            sc.entity_options_map[entity_name] = EntityOptions{};
+          }
         }
         if (sc.enabled) {
           config.sources.push_back(sc);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "column_batch.hpp"
 #include "entity_definition.hpp"
 #include <cassert>
+#include <cstring>
 #include <duckdb.hpp>
+#include <iostream>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
@@ -11,9 +14,28 @@
 
 using json = nlohmann::json;
 
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define DB_INGEST_APPENDER false // true: 列式 QueryAppender + INSERT…SELECT 合并; false: 拼 VALUES SQL
+                                 // (bench_ingest 有实测数据前保持 false)
+
 struct SyncCursor {
   std::string value;
   int skip = 0;
+  std::string id; // KEYSET: value 时间戳内已同步到的最大 id
+};
+
+// 一页待落盘数据 + 该页对应的游标快照
+struct PageWrite {
+  std::string table;
+  const char *columns = nullptr;
+  ColumnBatch rows;
+  std::string source;
+  std::string cursor_key;
+  SyncCursor cursor;
+  bool append = false; // 仅追加: 已剔除与已落盘行的重叠, 纯 INSERT 不走 ON CONFLICT; rows 可为空(只推进游标)
+  // cursor_key 为空: 只写行不动游标(离线重灌全量重拉分片的页)
 };
 
 class Database {
@@ -27,6 +49,7 @@ public:
   // 表初始化
   void init_sync_state() {
     execute(entities::SYNC_STATE_DDL);
+    execute(entities::SYNC_STATE_MIGRATE_DDL);
     execute(entities::ENTITY_STATS_META_DDL);
     execute(entities::INDEXER_FAIL_META_DDL);
   }
@@ -35,53 +58,117 @@ public:
 
   // 游标管理
   SyncCursor get_cursor(const std::string &source, const std::string &entity) {
-    std::string sql = "SELECT cursor_value, cursor_skip FROM sync_state WHERE source = '" +
+    std::string sql = "SELECT cursor_value, cursor_skip, cursor_id FROM sync_state WHERE source = '" +
                       entities::escape_sql_raw(source) + "' AND entity = '" +
                       entities::escape_sql_raw(entity) + "'";
     std::lock_guard<std::mutex> rlock(read_mutex_);
     auto result = read_conn_->Query(sql);
     if (result->RowCount() == 0)
-      return {"", 0};
+      return {"", 0, ""};
     auto val = result->GetValue(0, 0);
     auto skip = result->GetValue(1, 0);
+    auto id = result->GetValue(2, 0);
     return {
         val.IsNull() ? "" : val.ToString(),
-        skip.IsNull() ? 0 : skip.GetValue<int32_t>()};
-  }
-
-  // 原子写入：数据 + cursor 在同一事务
-  void atomic_insert_with_cursor(
-      const std::string &table, const std::string &columns,
-      const std::vector<std::string> &values_list,
-      const std::string &source, const std::string &entity,
-      const std::string &cursor_value, int cursor_skip) {
-    assert(!values_list.empty());
-
-    std::string insert_sql = "INSERT INTO " + table + " (" + columns + ") VALUES ";
-    for (size_t i = 0; i < values_list.size(); ++i) {
-      if (i > 0)
-        insert_sql += ", ";
-      insert_sql += "(" + values_list[i] + ")";
-    }
-    insert_sql += build_on_conflict_clause(columns);
+        skip.IsNull() ? 0 : skip.GetValue<int32_t>(),
+        id.IsNull() ? "" : id.ToString()};
+  }
 
-    std::string cursor_sql =
-        "INSERT OR REPLACE INTO sync_state (source, entity, cursor_value, cursor_skip, last_sync_at) VALUES (" +
-        entities::escape_sql(source) + ", " +
-        entities::escape_sql(entity) + ", " +
-        entities::escape_sql(cursor_value) + ", " +
-        std::to_string(cursor_skip) + ", CURRENT_TIMESTAMP)";
+  // entity 列以 prefix 开头的全部游标行(分片游标: "<Entity>@backfill:<hi>" 等)
+  std::vector<std::pair<std::string, SyncCursor>> get_cursors_with_prefix(
+      const std::string &source, const std::string &prefix) {
+    std::string sql = "SELECT entity, cursor_value, cursor_skip, cursor_id FROM sync_state WHERE source = '" +
+                      entities::escape_sql_raw(source) + "' AND starts_with(entity, '" +
+                      entities::escape_sql_raw(prefix) + "') ORDER BY entity";
+    std::lock_guard<std::mutex> rlock(read_mutex_);
+    auto result = read_conn_->Query(sql);
+    assert(!result->HasError() && "get_cursors_with_prefix failed");
+    std::vector<std::pair<std::string, SyncCursor>> out;
+    for (size_t i = 0; i < result->RowCount(); ++i) {
+      auto val = result->GetValue(1, i);
+      auto skip = result->GetValue(2, i);
+      auto id = result->GetValue(3, i);
+      out.emplace_back(result->GetValue(0, i).ToString(),
+                       SyncCursor{val.IsNull() ? "" : val.ToString(),
+                                  skip.IsNull() ? 0 : skip.GetValue<int32_t>(),
+                                  id.IsNull() ? "" : id.ToString()});
+    }
+    return out;
+  }
 
+  // 批量写游标(同一事务): 分片规划时各分片游标(及尾部游标)必须同时生效
+  void put_cursors(const std::string &source,
+                   const std::vector<std::pair<std::string, SyncCursor>> &cursors) {
     std::lock_guard<std::mutex> lock(write_mutex_);
+    auto r1 = conn_->Query("BEGIN TRANSACTION");
+    assert(!r1->HasError());
+    for (const auto &[entity, cursor] : cursors) {
+      auto r = conn_->Query(build_cursor_sql(source, entity, cursor));
+      assert(!r->HasError());
+    }
+    auto r2 = conn_->Query("COMMIT");
+    assert(!r2->HasError());
+  }
 
+  void delete_cursor(const std::string &source, const std::string &entity) {
+    execute("DELETE FROM sync_state WHERE source = " + entities::escape_sql(source) +
+            " AND entity = " + entities::escape_sql(entity));
+  }
+
+  // 全量重拉暂存表: 与 entity 表同结构(含主键, ON CONFLICT 依赖)
+  void ensure_staging_table(const entities::EntityDef *entity, const std::string &staging) {
+    std::string ddl = entity->ddl;
+    auto pos = ddl.find(entity->table);
+    assert(pos != std::string::npos);
+    ddl.replace(pos, std::strlen(entity->table), staging);
+    execute(ddl);
+  }
+
+  void recreate_staging_table(const entities::EntityDef *entity, const std::string &staging) {
+    execute("DROP TABLE IF EXISTS " + staging);
+    ensure_staging_table(entity, staging);
+  }
+
+  // 暂存表原子换入: 改名交换 + 完成标记游标同一事务, 读端只会看到旧表或新表
+  void swap_staging_table(const std::string &table, const std::string &staging,
+                          const std::string &source, const std::string &entity,
+                          const SyncCursor &cursor) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
     auto r1 = conn_->Query("BEGIN TRANSACTION");
     assert(!r1->HasError());
-    auto r2 = conn_->Query(insert_sql);
+    auto r2 = conn_->Query("ALTER TABLE " + table + " RENAME TO " + table + "__old");
     assert(!r2->HasError());
-    auto r3 = conn_->Query(cursor_sql);
+    auto r3 = conn_->Query("ALTER TABLE " + staging + " RENAME TO " + table);
     assert(!r3->HasError());
-    auto r4 = conn_->Query("COMMIT");
+    auto r4 = conn_->Query("DROP TABLE " + table + "__old");
     assert(!r4->HasError());
+    auto r5 = conn_->Query(build_cursor_sql(source, entity, cursor));
+    assert(!r5->HasError());
+    auto r6 = conn_->Query("COMMIT");
+    assert(!r6->HasError());
+  }
+
+  // 原子写入(组提交): 多页(可跨 entity/source)同一事务, 每页数据与其游标同生同灭;
+  // 同一游标的多页按顺序写, 后者覆盖前者
+  // appender: 列值按类型直接进 DuckDB 数据块, 免去 VALUES 文本的拼接/词法/解析/规划;
+  //           否则走 SQL 文本路径(锁外拼好)
+  // 仅追加页若撞主键约束(如链重组后同 id 事件以新时间戳重现), 整组回滚后按 upsert 重写
+  // 返回 false: 其它失败或 upsert 重写仍失败, 整组已回滚(游标未动), 原因写入 error
+  bool atomic_insert_pages(const std::vector<const PageWrite *> &pages, std::string &error,
+                           bool appender = DB_INGEST_APPENDER) {
+    assert(!pages.empty());
+    std::vector<std::string> sqls;
+    if (!appender)
+      sqls = build_page_sqls(pages, true);
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto status = appender ? append_transaction(pages, true, error) : run_transaction(sqls, error);
+    if (status == TxStatus::CONFLICT) {
+      std::cerr << "[DB] append-only insert conflict, retrying " << pages.size() << " page(s) as upsert" << std::endl;
+      status = appender ? append_transaction(pages, false, error)
+                        : run_transaction(build_page_sqls(pages, false), error);
+    }
+    return status == TxStatus::OK;
   }
 
   void execute(const std::string &sql) {
@@ -90,6 +177,19 @@ public:
     assert(!result->HasError() && "execute failed");
   }
 
+  // 批量导入: INSERT OR IGNORE … SELECT (DuckDB 原生读取器, 多线程扫描); 已有行不覆盖(线上数据比转储新)
+  // 返回插入行数, 失败返回 -1 并写入 error
+  int64_t insert_select(const std::string &table, const char *columns, const std::string &select,
+                        std::string &error) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto result = conn_->Query("INSERT OR IGNORE INTO " + table + " (" + columns + ") " + select);
+    if (result->HasError()) {
+      error = result->GetError();
+      return -1;
+    }
+    return result->GetValue(0, 0).GetValue<int64_t>();
+  }
+
   // 只读查询
   int64_t get_table_count(const std::string &table) {
     std::lock_guard<std::mutex> rlock(read_mutex_);
@@ -99,9 +199,14 @@ public:
     return result->GetValue(0, 0).GetValue<int64_t>();
   }
 
-  json query_json(const std::string &sql) {
+  // error 非空时查询失败返回空数组并写入错误信息(用户给的 SQL/文件路径), 否则断言
+  json query_json(const std::string &sql, std::string *error = nullptr) {
     std::lock_guard<std::mutex> rlock(read_mutex_);
     auto result = read_conn_->Query(sql);
+    if (error && result->HasError()) {
+      *error = result->GetError();
+      return json::array();
+    }
     assert(!result->HasError() && "query_json failed");
 
     json rows = json::array();
@@ -153,24 +258,45 @@ public:
         "AND condition.positionIds IS NULL");
   }
 
-  std::vector<std::string> get_null_positionid_conditions(int limit = 100) {
+  // 全部 positionIds 为 NULL 的 condition id (按 resolutionTimestamp 顺序), 由填充器一次取出后分批在途
+  std::vector<std::string> get_null_positionid_conditions() {
     std::lock_guard<std::mutex> rlock(read_mutex_);
     auto result = read_conn_->Query(
         "SELECT id FROM condition WHERE positionIds IS NULL "
-        "ORDER BY resolutionTimestamp LIMIT " +
-        std::to_string(limit));
+        "ORDER BY resolutionTimestamp");
     std::vector<std::string> ids;
     assert(!result->HasError());
+    ids.reserve(result->RowCount());
     for (size_t i = 0; i < result->RowCount(); ++i) {
       ids.push_back(result->GetValue(0, i).ToString());
     }
     return ids;
   }
 
-  void update_condition_position_ids(const std::string &id, const std::string &position_ids) {
-    execute("UPDATE condition SET positionIds = " +
-            entities::escape_sql(position_ids) +
-            " WHERE id = " + entities::escape_sql(id));
+  // 一批 (id, positionIds) 经 QueryAppender 暂存为内存表 appended_data, 一条 UPDATE…FROM 连接写回;
+  // 只覆盖仍为 NULL 的行(与 merge 幂等). 失败返回 false
+  bool apply_position_ids(const std::vector<std::pair<std::string, std::string>> &rows) {
+    if (rows.empty())
+      return true;
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    try {
+      duckdb::QueryAppender app(
+          *conn_,
+          "UPDATE condition SET positionIds = appended_data.positionIds FROM appended_data "
+          "WHERE condition.id = appended_data.id AND condition.positionIds IS NULL",
+          {duckdb::LogicalType::VARCHAR, duckdb::LogicalType::VARCHAR}, {"id", "positionIds"});
+      for (const auto &[id, position_ids] : rows) {
+        app.BeginRow();
+        app.Append(id.data(), static_cast<uint32_t>(id.size()));
+        app.Append(position_ids.data(), static_cast<uint32_t>(position_ids.size()));
+        app.EndRow();
+      }
+      app.Close();
+    } catch (const std::exception &e) {
+      std::cerr << "[DB] apply_position_ids failed: " << e.what() << std::endl;
+      return false;
+    }
+    return true;
   }
 
   // ============================================================================
@@ -190,19 +316,158 @@ public:
   duckdb::DuckDB &get_duckdb() { return *db_; }
 
 private:
+  static std::string build_cursor_sql(const std::string &source, const std::string &entity,
+                                      const SyncCursor &cursor) {
+    return "INSERT OR REPLACE INTO sync_state (source, entity, cursor_value, cursor_skip, cursor_id, last_sync_at) VALUES (" +
+           entities::escape_sql(source) + ", " +
+           entities::escape_sql(entity) + ", " +
+           entities::escape_sql(cursor.value) + ", " +
+           std::to_string(cursor.skip) + ", " +
+           (cursor.id.empty() ? std::string("NULL") : entities::escape_sql(cursor.id)) +
+           ", CURRENT_TIMESTAMP)";
+  }
+
+  // allow_append=false: 仅追加页也带 ON CONFLICT(冲突重试用)
+  static std::vector<std::string> build_page_sqls(const std::vector<const PageWrite *> &pages, bool allow_append) {
+    std::vector<std::string> sqls;
+    sqls.reserve(pages.size() * 2);
+    for (const auto *p : pages) {
+      if (!p->rows.empty()) {
+        std::string insert_sql;
+        insert_sql.reserve(64 + p->rows.byte_size() * 2);
+        insert_sql += "INSERT INTO " + p->table + " (" + p->columns + ") VALUES ";
+        p->rows.append_sql_tuples(insert_sql);
+        if (!(allow_append && p->append))
+          insert_sql += build_on_conflict_clause(p->columns);
+        sqls.push_back(std::move(insert_sql));
+      }
+      if (!p->cursor_key.empty())
+        sqls.push_back(build_cursor_sql(p->source, p->cursor_key, p->cursor));
+    }
+    return sqls;
+  }
+
+  // 事务结果: CONFLICT = 约束冲突(仅追加页可按 upsert 重试), FAILED = 其它错误
+  enum class TxStatus { OK, CONFLICT, FAILED };
+
+  static TxStatus classify(const duckdb::ErrorData &err, std::string &error) {
+    error = err.Message();
+    return err.Type() == duckdb::ExceptionType::CONSTRAINT ? TxStatus::CONFLICT : TxStatus::FAILED;
+  }
+
+  TxStatus rollback(TxStatus status) {
+    auto rb = conn_->Query("ROLLBACK");
+    assert(!rb->HasError());
+    return status;
+  }
+
+  // 提交失败时 DuckDB 已回滚事务
+  TxStatus commit(std::string &error) {
+    auto r = conn_->Query("COMMIT");
+    if (r->HasError()) {
+      error = r->GetError();
+      return TxStatus::FAILED;
+    }
+    return TxStatus::OK;
+  }
+
+  // Appender 路径: 每页经 QueryAppender 注册为内存表 appended_data, 再 INSERT…SELECT 合并进目标表
+  // (upsert 页带 ON CONFLICT), 游标 SQL 同事务; 任一步失败则回滚 (调用方持有 write_mutex_)
+  TxStatus append_transaction(const std::vector<const PageWrite *> &pages, bool allow_append, std::string &error) {
+    auto r1 = conn_->Query("BEGIN TRANSACTION");
+    assert(!r1->HasError());
+    for (const auto *p : pages) {
+      if (!p->rows.empty()) {
+        try {
+          auto names = entities::split_columns(p->columns);
+          duckdb::QueryAppender app(*conn_, build_merge_sql(*p, allow_append), appender_types(p->rows),
+                                    duckdb::vector<std::string>(names.begin(), names.end()));
+          append_batch(app, p->rows);
+          app.Close();
+        } catch (const std::exception &ex) { // Flush 时抛出; 主键冲突之外的错误不重试
+          return rollback(classify(duckdb::ErrorData(ex), error));
+        }
+      }
+      if (!p->cursor_key.empty()) {
+        auto r = conn_->Query(build_cursor_sql(p->source, p->cursor_key, p->cursor));
+        if (r->HasError()) {
+          error = r->GetError();
+          return rollback(TxStatus::FAILED);
+        }
+      }
+    }
+    return commit(error);
+  }
+
+  static std::string build_merge_sql(const PageWrite &p, bool allow_append) {
+    std::string sql = "INSERT INTO " + p.table + " (" + p.columns + ") SELECT * FROM appended_data";
+    if (!(allow_append && p.append))
+      sql += build_on_conflict_clause(p.columns);
+    return sql;
+  }
+
+  // ColumnBatch 列类型 → 追加数据块类型; 与目标列类型(INT/TIMESTAMP 等)的差异由 INSERT…SELECT 隐式转换
+  static duckdb::vector<duckdb::LogicalType> appender_types(const ColumnBatch &rows) {
+    duckdb::vector<duckdb::LogicalType> types;
+    for (size_t c = 0; c < rows.column_count(); ++c) {
+      switch (rows.type(c)) {
+      case entities::ColumnType::INT:
+        types.push_back(duckdb::LogicalType::BIGINT);
+        break;
+      case entities::ColumnType::DECIMAL:
+        types.push_back(duckdb::LogicalType::DOUBLE);
+        break;
+      default:
+        types.push_back(duckdb::LogicalType::VARCHAR);
+        break;
+      }
+    }
+    return types;
+  }
+
+  static void append_batch(duckdb::BaseAppender &app, const ColumnBatch &rows) {
+    for (size_t r = 0; r < rows.size(); ++r) {
+      app.BeginRow();
+      for (size_t c = 0; c < rows.column_count(); ++c) {
+        if (rows.is_null(c, r)) {
+          app.Append(nullptr);
+          continue;
+        }
+        switch (rows.type(c)) {
+        case entities::ColumnType::INT:
+          app.Append<int64_t>(rows.get_int(c, r));
+          break;
+        case entities::ColumnType::DECIMAL:
+          app.Append<double>(rows.get_double(c, r));
+          break;
+        default: {
+          auto s = rows.get_text(c, r);
+          app.Append(s.data(), static_cast<uint32_t>(s.size()));
+          break;
+        }
+        }
+      }
+      app.EndRow();
+    }
+  }
+
+  // 单事务执行; 任一语句失败则回滚 (调用方持有 write_mutex_)
+  TxStatus run_transaction(const std::vector<std::string> &sqls, std::string &error) {
+    auto r1 = conn_->Query("BEGIN TRANSACTION");
+    assert(!r1->HasError());
+    for (const auto &sql : sqls) {
+      auto r = conn_->Query(sql);
+      if (r->HasError())
+        return rollback(classify(r->GetErrorObject(), error));
+    }
+    return commit(error);
+  }
+
   static std::string build_on_conflict_clause(const std::string &columns) {
     std::string clause = " ON CONFLICT(id) DO UPDATE SET ";
     bool first = true;
-    size_t pos = 0;
-    while (pos < columns.size()) {
-      size_t comma = columns.find(',', pos);
-      std::string col_raw = (comma == std::string::npos)
-          ? columns.substr(pos) : columns.substr(pos, comma - pos);
-      size_t b = col_raw.find_first_not_of(" ");
-      size_t e = col_raw.find_last_not_of(" ");
-      std::string col = (b != std::string::npos) ? col_raw.substr(b, e - b + 1) : "";
-      pos = (comma == std::string::npos) ? columns.size() : comma + 1;
-      if (col.empty() || col == "id") continue;
+    for (const auto &col : entities::split_columns(columns)) {
+      if (col == "id") continue;
       if (!first) clause += ", ";
       clause += col + "=excluded." + col;
       first = false;
@@ -7,8 +7,11 @@
 
 #include <cassert>
 #include <cctype>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include <span>
 #include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -21,6 +24,24 @@ enum class SyncMode {
   TIMESTAMP,     // orderBy: timestamp, where: {timestamp_gte}, + skip
   RESOLUTION_TS, // orderBy: resolutionTimestamp, where: {resolutionTimestamp_gte}, + skip
   ID,            // orderBy: id, where: {id_gt} (no skip)
+  KEYSET,        // orderBy: timestamp(+id), where: {or:[{timestamp, id_gt}, {timestamp_gt}]} (no skip)
+};
+
+// ============================================================================
+// 列类型 (流式解码用, 决定 GraphQL 值 → 列缓冲的转换方式)
+// ============================================================================
+enum class ColumnType : uint8_t {
+  TEXT,    // JSON string → VARCHAR
+  REF,     // { id } 嵌套对象 → VARCHAR (取 id)
+  INT,     // BigInt 字符串/数字 → int64 (BIGINT/INT)
+  BIGNUM,  // 大整数字符串 → VARCHAR (保留原文数字)
+  DECIMAL, // BigDecimal 字符串 → double (DOUBLE)
+  JSON,    // 数组/对象 → VARCHAR (紧凑 JSON 原文)
+};
+
+struct ColumnSpec {
+  const char *field; // GraphQL 字段名 (与 columns 同序)
+  ColumnType type;
 };
 
 // ============================================================================
@@ -97,10 +118,15 @@ CREATE TABLE IF NOT EXISTS sync_state (
     entity VARCHAR NOT NULL,
     cursor_value VARCHAR,
     cursor_skip INT DEFAULT 0,
+    cursor_id VARCHAR,
     last_sync_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     PRIMARY KEY (source, entity)
 ))";
 
+// 旧库迁移: keyset 游标的边界 id
+inline const char *SYNC_STATE_MIGRATE_DDL =
+    "ALTER TABLE sync_state ADD COLUMN IF NOT EXISTS cursor_id VARCHAR";
+
 inline const char *ENTITY_STATS_META_DDL = R"(
 CREATE TABLE IF NOT EXISTS entity_stats_meta (
     source VARCHAR NOT NULL,
@@ -142,7 +168,9 @@ struct EntityDef {
   SyncMode sync_mode;                     // 同步模式
   const char *order_field;                // orderBy 字段名
   const char *where_field;                // where 过滤字段名
-  std::string (*to_values)(const json &); // JSON 转 SQL values
+  bool append_only;                       // 不可变事件: 行一经索引不再变化, 落盘走纯 INSERT
+  std::string (*to_values)(const json &); // JSON 转 SQL values (DOM 路径, 仅基准对照)
+  std::span<const ColumnSpec> schema;     // 流式解码列定义 (与 columns 同序)
 };
 
 // ============================================================================
@@ -271,6 +299,15 @@ inline std::string condition_to_values(const json &j) {
          json_int(j, "payoutDenominator");
 }
 
+inline constexpr ColumnSpec CONDITION_SCHEMA[] = {
+    {"id", ColumnType::TEXT},
+    {"questionId", ColumnType::TEXT},
+    {"oracle", ColumnType::TEXT},
+    {"outcomeSlotCount", ColumnType::INT},
+    {"resolutionTimestamp", ColumnType::INT},
+    {"payoutNumerators", ColumnType::JSON},
+    {"payoutDenominator", ColumnType::INT}};
+
 inline const EntityDef Condition = {
     .name = "Condition",
     .plural = "conditions",
@@ -290,7 +327,9 @@ inline const EntityDef Condition = {
     .sync_mode = SyncMode::RESOLUTION_TS,
     .order_field = "resolutionTimestamp",
     .where_field = "resolutionTimestamp_gte",
-    .to_values = condition_to_values};
+    .append_only = false,
+    .to_values = condition_to_values,
+    .schema = CONDITION_SCHEMA};
 
 // EnrichedOrderFilled - 订单成交
 inline std::string enriched_order_filled_to_values(const json &j) {
@@ -304,6 +343,16 @@ inline std::string enriched_order_filled_to_values(const json &j) {
          json_decimal(j, "price");
 }
 
+inline constexpr ColumnSpec ENRICHED_ORDER_FILLED_SCHEMA[] = {
+    {"id", ColumnType::TEXT},
+    {"timestamp", ColumnType::INT},
+    {"maker", ColumnType::REF},
+    {"taker", ColumnType::REF},
+    {"market", ColumnType::REF},
+    {"side", ColumnType::TEXT},
+    {"size", ColumnType::BIGNUM},
+    {"price", ColumnType::DECIMAL}};
+
 inline const EntityDef EnrichedOrderFilled = {
     .name = "EnrichedOrderFilled",
     .plural = "enrichedOrderFilleds",
@@ -321,10 +370,12 @@ inline const EntityDef EnrichedOrderFilled = {
     );
     CREATE INDEX IF NOT EXISTS idx_eof_ts ON enriched_order_filled(timestamp))",
     .columns = "id, timestamp, maker, taker, market, side, size, price",
-    .sync_mode = SyncMode::TIMESTAMP,
+    .sync_mode = SyncMode::KEYSET,
     .order_field = "timestamp",
     .where_field = "timestamp_gte",
-    .to_values = enriched_order_filled_to_values};
+    .append_only = true,
+    .to_values = enriched_order_filled_to_values,
+    .schema = ENRICHED_ORDER_FILLED_SCHEMA};
 
 // ============================================================================
 // Activity Polygon Entities (flat fields, no { id } expansion)
@@ -339,6 +390,13 @@ inline std::string split_merge_to_values(const json &j) {
          json_int(j, "amount");
 }
 
+inline constexpr ColumnSpec SPLIT_MERGE_SCHEMA[] = {
+    {"id", ColumnType::TEXT},
+    {"timestamp", ColumnType::INT},
+    {"stakeholder", ColumnType::TEXT},
+    {"condition", ColumnType::TEXT},
+    {"amount", ColumnType::BIGNUM}};
+
 inline const EntityDef Split = {
     .name = "Split",
     .plural = "splits",
@@ -353,10 +411,12 @@ inline const EntityDef Split = {
     );
     CREATE INDEX IF NOT EXISTS idx_split_ts ON split(timestamp))",
     .columns = "id, timestamp, stakeholder, condition, amount",
-    .sync_mode = SyncMode::TIMESTAMP,
+    .sync_mode = SyncMode::KEYSET,
     .order_field = "timestamp",
     .where_field = "timestamp_gte",
-    .to_values = split_merge_to_values};
+    .append_only = true,
+    .to_values = split_merge_to_values,
+    .schema = SPLIT_MERGE_SCHEMA};
 
 // Merge - 销毁 (YES + NO → USDC)
 inline const EntityDef Merge = {
@@ -373,10 +433,12 @@ inline const EntityDef Merge = {
     );
     CREATE INDEX IF NOT EXISTS idx_merge_ts ON merge(timestamp))",
     .columns = "id, timestamp, stakeholder, condition, amount",
-    .sync_mode = SyncMode::TIMESTAMP,
+    .sync_mode = SyncMode::KEYSET,
     .order_field = "timestamp",
     .where_field = "timestamp_gte",
-    .to_values = split_merge_to_values};
+    .append_only = true,
+    .to_values = split_merge_to_values,
+    .schema = SPLIT_MERGE_SCHEMA};
 
 // Redemption - 赎回 (tokens → USDC, 市场结算后)
 inline std::string redemption_to_values(const json &j) {
@@ -388,6 +450,14 @@ inline std::string redemption_to_values(const json &j) {
          json_int(j, "payout");
 }
 
+inline constexpr ColumnSpec REDEMPTION_SCHEMA[] = {
+    {"id", ColumnType::TEXT},
+    {"timestamp", ColumnType::INT},
+    {"redeemer", ColumnType::TEXT},
+    {"condition", ColumnType::TEXT},
+    {"indexSets", ColumnType::JSON},
+    {"payout", ColumnType::BIGNUM}};
+
 inline const EntityDef Redemption = {
     .name = "Redemption",
     .plural = "redemptions",
@@ -403,10 +473,12 @@ inline const EntityDef Redemption = {
     );
     CREATE INDEX IF NOT EXISTS idx_redemption_ts ON redemption(timestamp))",
     .columns = "id, timestamp, redeemer, condition, indexSets, payout",
-    .sync_mode = SyncMode::TIMESTAMP,
+    .sync_mode = SyncMode::KEYSET,
     .order_field = "timestamp",
     .where_field = "timestamp_gte",
-    .to_values = redemption_to_values};
+    .append_only = true,
+    .to_values = redemption_to_values,
+    .schema = REDEMPTION_SCHEMA};
 
 // ============================================================================
 // PnL Subgraph Entities
@@ -417,6 +489,10 @@ inline std::string pnl_condition_to_values(const json &j) {
          json_array(j, "positionIds");
 }
 
+inline constexpr ColumnSpec PNL_CONDITION_SCHEMA[] = {
+    {"id", ColumnType::TEXT},
+    {"positionIds", ColumnType::JSON}};
+
 inline const EntityDef PnlCondition = {
     .name = "Condition",
     .plural = "conditions",
@@ -430,7 +506,9 @@ inline const EntityDef PnlCondition = {
     .sync_mode = SyncMode::ID,
     .order_field = "id",
     .where_field = "id_gt",
-    .to_values = pnl_condition_to_values};
+    .append_only = false,
+    .to_values = pnl_condition_to_values,
+    .schema = PNL_CONDITION_SCHEMA};
 
 // ============================================================================
 // Entity 注册表 (按 subgraph 分组)
@@ -457,4 +535,29 @@ inline const EntityDef *find_entity_by_table(const char *table) {
   return nullptr;
 }
 
+// INSERT 列名串 "a, b, c" → {"a", "b", "c"}
+inline std::vector<std::string> split_columns(const std::string &columns) {
+  std::vector<std::string> out;
+  size_t pos = 0;
+  while (pos < columns.size()) {
+    size_t comma = columns.find(',', pos);
+    std::string col_raw = (comma == std::string::npos) ? columns.substr(pos) : columns.substr(pos, comma - pos);
+    size_t b = col_raw.find_first_not_of(" ");
+    size_t e = col_raw.find_last_not_of(" ");
+    pos = (comma == std::string::npos) ? columns.size() : comma + 1;
+    if (b != std::string::npos)
+      out.push_back(col_raw.substr(b, e - b + 1));
+  }
+  return out;
+}
+
+// 查找列下标 (schema 中的位置), 不存在返回 -1
+inline int find_column(const EntityDef *e, const char *field) {
+  for (size_t i = 0; i < e->schema.size(); ++i) {
+    if (std::string(e->schema[i].field) == field)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
 } // namespace entities
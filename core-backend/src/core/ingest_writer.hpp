@@ -0,0 +1,234 @@
+#pragma once
+
+// ============================================================================
+// IngestWriter - 独立写库线程 + 有界队列
+//   执行器把 (列式页, 游标快照) 交给队列后继续拉取; 写线程按 FIFO 取页,
+//   组提交: 短窗口内到达的多页(跨 entity/source)合成一个事务, 每页数据与游标仍同生同灭,
+//   完成后把 ColumnBatch 经 io_context 交还执行器复用
+//   队列计数只在 io 线程维护: 提交 +1, 完成回调 -1; 满时执行器暂停发新请求, 有空位再唤醒
+//   在写的页持有 io_context 的 work guard: 写库期间 io 上没有别的事件时 run() 也不会提前返回
+//   游标/暂存表等库操作(task)同走此队列: 与页严格 FIFO, 单独执行不并组, 不计入队列深度;
+//   io 线程因此从不持有 Database::write_mutex_; StatsManager 的统计落盘同样经此执行
+//   写库失败: 组事务失败后逐页重写以隔离失败页; 失败页所在游标此后的页一律不写(否则游标越过缺口),
+//   回调 ok=false, 由执行器等在写页回完后 resume_cursor 并从库中游标重拉
+// ============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "../stats/stats_manager.hpp"
+#include "column_batch.hpp"
+#include "database.hpp"
+
+namespace asio = boost::asio;
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define INGEST_QUEUE_DEPTH 8       // 排队 + 写入中的页数上限(超出时执行器暂停拉取)
+#define GROUP_COMMIT_WINDOW_MS 2    // 只有一页时等待更多页的时长(0 = 不等)
+#define GROUP_COMMIT_MAX_PAGES 16   // 单个事务最多页数
+
+class IngestWriter {
+public:
+  using Job = PageWrite;
+  using DoneCallback = std::function<void(ColumnBatch &&, bool ok)>; // io 线程回调, 交还已清空的页; ok=false 未落盘
+  using ReadyCallback = std::function<void()>;
+  using Task = std::function<void(Database &)>; // 写线程执行
+  using TaskCallback = std::function<void()>;   // io 线程回调
+
+  IngestWriter(Database &db, asio::io_context &ioc, size_t capacity = INGEST_QUEUE_DEPTH)
+      : db_(db), ioc_(ioc), capacity_(capacity), thread_([this]() { run(); }) {
+    // 统计落盘也排进写线程(任意线程调用)
+    StatsManager::instance().set_persister([this](std::string sql) {
+      run_task([sql = std::move(sql)](Database &database) { database.execute(sql); });
+    });
+  }
+
+  ~IngestWriter() {
+    StatsManager::instance().set_persister({});
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join(); // 已入队的页写完再退出
+  }
+
+  IngestWriter(const IngestWriter &) = delete;
+  IngestWriter &operator=(const IngestWriter &) = delete;
+
+  // 以下均在 io 线程调用
+  void submit(Job job, DoneCallback on_done) {
+    ++queued_;
+    StatsManager::instance().set_writer_queue(queued_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back({std::move(job), std::move(on_done), asio::make_work_guard(ioc_), {}, {}});
+    }
+    cv_.notify_one();
+  }
+
+  // 排在此前提交的页之后执行; 之后提交的页在其完成后才写
+  void run_task(Task task, TaskCallback on_done = {}) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back({{}, {}, asio::make_work_guard(ioc_), std::move(task), std::move(on_done)});
+    }
+    cv_.notify_one();
+  }
+
+  // 失败游标恢复写入(排在此前提交的页之后, 这些页仍会被拒)
+  void resume_cursor(const std::string &source, const std::string &cursor_key, TaskCallback on_done = {}) {
+    run_task([this, key = failed_key(source, cursor_key)](Database &) { failed_keys_.erase(key); }, std::move(on_done));
+  }
+
+  bool full() const { return queued_ >= capacity_; }
+
+  // 队列满时登记, 有空位后按登记顺序回调
+  void on_ready(ReadyCallback cb) {
+    StatsManager::instance().record_writer_stall();
+    waiters_.push_back(std::move(cb));
+  }
+
+private:
+  struct Item {
+    Job job;
+    DoneCallback on_done;
+    asio::executor_work_guard<asio::io_context::executor_type> work; // 完成回调执行后随组析构释放
+    Task task;                 // 非空 = 库操作, job/on_done 不用
+    TaskCallback on_task_done;
+  };
+
+  void run() {
+    for (;;) {
+      std::vector<Item> group;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty())
+          return;
+        if (jobs_.size() == 1 && !jobs_.front().task && !stop_ && GROUP_COMMIT_WINDOW_MS > 0) {
+          cv_.wait_for(lock, std::chrono::milliseconds(GROUP_COMMIT_WINDOW_MS),
+                       [this]() { return stop_ || jobs_.size() > 1; });
+        }
+        // task 自成一组; 页组遇到 task 即截止
+        while (!jobs_.empty() && group.size() < GROUP_COMMIT_MAX_PAGES) {
+          bool task = static_cast<bool>(jobs_.front().task);
+          if (task && !group.empty())
+            break;
+          group.push_back(std::move(jobs_.front()));
+          jobs_.pop_front();
+          if (task)
+            break;
+        }
+      }
+
+      if (group.front().task) {
+        group.front().task(db_);
+        asio::post(ioc_, [item = std::move(group.front())]() mutable {
+          if (item.on_task_done)
+            item.on_task_done();
+        });
+        continue;
+      }
+
+      auto t0 = std::chrono::steady_clock::now();
+      std::vector<uint8_t> ok(group.size(), 0);
+      std::vector<const PageWrite *> pages;
+      int64_t rows = 0;
+      for (size_t i = 0; i < group.size(); ++i) {
+        if (failed_keys_.contains(failed_key(group[i].job)))
+          continue;
+        ok[i] = 1;
+        pages.push_back(&group[i].job);
+        rows += static_cast<int64_t>(group[i].job.rows.size());
+      }
+      std::string error;
+      if (!pages.empty() && !db_.atomic_insert_pages(pages, error)) {
+        std::cerr << "[Writer] group of " << pages.size() << " page(s) failed: " << error << std::endl;
+        rows = write_alone(group, ok);
+      }
+      int64_t written = std::count(ok.begin(), ok.end(), 1);
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+      if (written > 0)
+        StatsManager::instance().record_writer_commit(written, rows, ms);
+      if (written < static_cast<int64_t>(group.size()))
+        StatsManager::instance().record_writer_failure(static_cast<int64_t>(group.size()) - written);
+
+      asio::post(ioc_, [this, group = std::move(group), ok = std::move(ok)]() mutable { on_committed(group, ok); });
+    }
+  }
+
+  // 组事务失败: 逐页单独重写, 失败页的游标此后停写; 返回写入行数
+  int64_t write_alone(const std::vector<Item> &group, std::vector<uint8_t> &ok) {
+    int64_t rows = 0;
+    for (size_t i = 0; i < group.size(); ++i) {
+      if (!ok[i])
+        continue;
+      auto key = failed_key(group[i].job);
+      std::string error;
+      if (failed_keys_.contains(key) || !db_.atomic_insert_pages({&group[i].job}, error)) {
+        if (!error.empty())
+          std::cerr << "[Writer] " << key << " page failed, cursor held: " << error << std::endl;
+        failed_keys_.insert(key);
+        ok[i] = 0;
+        continue;
+      }
+      rows += static_cast<int64_t>(group[i].job.rows.size());
+    }
+    return rows;
+  }
+
+  static std::string failed_key(const std::string &source, const std::string &cursor_key) {
+    return source + "/" + cursor_key;
+  }
+  static std::string failed_key(const PageWrite &job) { return failed_key(job.source, job.cursor_key); }
+
+  // 组内按入队顺序回调(同一执行器的页保持 FIFO)
+  void on_committed(std::vector<Item> &group, const std::vector<uint8_t> &ok) {
+    queued_ -= group.size();
+    StatsManager::instance().set_writer_queue(queued_);
+    for (size_t i = 0; i < group.size(); ++i) {
+      auto &item = group[i];
+      item.job.rows.clear();
+      item.on_done(std::move(item.job.rows), ok[i] != 0);
+    }
+    while (!full() && !waiters_.empty()) {
+      auto cb = std::move(waiters_.front());
+      waiters_.pop_front();
+      cb();
+    }
+  }
+
+  Database &db_;
+  asio::io_context &ioc_;
+  size_t capacity_;
+
+  // io 线程
+  size_t queued_ = 0;
+  std::deque<ReadyCallback> waiters_;
+
+  // 写线程共享
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Item> jobs_;
+  bool stop_ = false;
+
+  // 写线程
+  std::unordered_set<std::string> failed_keys_; // source/cursor_key: 有页写失败, 等执行器 resume_cursor
+  std::thread thread_; // 最后构造: 依赖以上成员
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+// ============================================================================
+// MemoryBudget - sync 拉取/落盘链路的全局内存预算(按字节)
+//   执行器发页请求前按预估体积占用额度, 解码后改为实际列缓冲大小, 落盘完成后释放;
+//   HttpsPool 排队中的请求 body、PageArchive 待写盘的记录同样计入
+//   额度不足时生产方登记等待, 释放后按登记顺序占用并回调; 当前无人占用时总是放行(保证进展)
+//   上限之外留给 DuckDB 与重建引擎的工作集
+//   线程安全; 等待回调在释放方线程执行(sync 链路的释放都在 io 线程)
+// ============================================================================
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../stats/stats_manager.hpp"
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define INGEST_MEMORY_DEFAULT_MB 256 // 默认上限(config "ingest_memory_mb" 可改)
+
+class MemoryBudget {
+public:
+  using ReadyCallback = std::function<void()>;
+
+  static MemoryBudget &instance() {
+    static MemoryBudget inst;
+    return inst;
+  }
+
+  void set_limit(size_t bytes) {
+    std::vector<ReadyCallback> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      limit_ = bytes;
+      grant(ready);
+      publish();
+    }
+    for (auto &ready_cb : ready)
+      ready_cb();
+  }
+
+  size_t limit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+  }
+
+  size_t used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+  }
+
+  // 额度够则占用并返回 true; 已有等待者时不插队
+  bool try_acquire(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!waiters_.empty() || !fits(bytes))
+      return false;
+    take(bytes);
+    return true;
+  }
+
+  // try_acquire 失败后登记: 额度够时按登记顺序占用并回调
+  void wait(size_t bytes, ReadyCallback cb) {
+    std::vector<ReadyCallback> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stalls_;
+      waiters_.push_back({bytes, std::move(cb)});
+      grant(ready); // 登记前恰有释放时不至于漏掉
+      publish();
+    }
+    for (auto &ready_cb : ready)
+      ready_cb();
+  }
+
+  // 已在内存中的数据(排队的请求 body 等): 无条件计入, 超出上限时后续 try_acquire 暂停
+  void acquire(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    take(bytes);
+  }
+
+  void release(size_t bytes) {
+    std::vector<ReadyCallback> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= std::min(bytes, used_);
+      grant(ready);
+      publish();
+    }
+    for (auto &ready_cb : ready)
+      ready_cb();
+  }
+
+  // 预留改为实际大小
+  void resize(size_t from, size_t to) {
+    if (to > from)
+      acquire(to - from);
+    else if (from > to)
+      release(from - to);
+  }
+
+private:
+  MemoryBudget() { publish(); }
+
+  struct Waiter {
+    size_t bytes;
+    ReadyCallback cb;
+  };
+
+  bool fits(size_t bytes) const { return used_ == 0 || used_ + bytes <= limit_; }
+
+  void take(size_t bytes) {
+    used_ += bytes;
+    peak_ = std::max(peak_, used_);
+    publish();
+  }
+
+  void grant(std::vector<ReadyCallback> &ready) {
+    while (!waiters_.empty() && fits(waiters_.front().bytes)) {
+      take(waiters_.front().bytes);
+      ready.push_back(std::move(waiters_.front().cb));
+      waiters_.pop_front();
+    }
+  }
+
+  void publish() const {
+    StatsManager::instance().set_memory({static_cast<int64_t>(limit_), static_cast<int64_t>(used_),
+                                         static_cast<int64_t>(peak_), stalls_,
+                                         static_cast<int64_t>(waiters_.size())});
+  }
+
+  mutable std::mutex mutex_;
+  size_t limit_ = static_cast<size_t>(INGEST_MEMORY_DEFAULT_MB) * 1024 * 1024;
+  size_t used_ = 0;
+  size_t peak_ = 0;
+  int64_t stalls_ = 0;
+  std::deque<Waiter> waiters_;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+// ============================================================================
+// AimdLimiter - 在途请求窗口(加性增 / 乘性减)
+//   成功且延时接近基线: window += 1 / window (约每轮窗口 +1)
+//   延时膨胀(> 基线 * 倍数)或过载类失败: window *= 系数, 每个冷却期至多减一次
+// ============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "../stats/stats_manager.hpp"
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define AIMD_WINDOW_MIN 2
+#define AIMD_WINDOW_MAX 64
+#define AIMD_LATENCY_FACTOR 2.0    // EWMA 延时超过基线的倍数视为排队
+#define AIMD_BACKOFF_LATENCY 0.8   // 延时膨胀时的乘性系数
+#define AIMD_BACKOFF_FAILURE 0.5   // 失败时的乘性系数
+#define AIMD_MIN_COOLDOWN_MS 200   // 两次减小的最小间隔(另取 EWMA 延时)
+
+class AimdLimiter {
+public:
+  // max: 窗口上限(多 key 时按 key 数放大)
+  explicit AimdLimiter(int initial, int max = AIMD_WINDOW_MAX)
+      : max_(max), window_(std::clamp<double>(initial, AIMD_WINDOW_MIN, max)) {}
+
+  int limit() const { return static_cast<int>(window_); }
+  double window() const { return window_; }
+  double latency_ewma_ms() const { return latency_ewma_; }
+  double baseline_ms() const { return baseline_; }
+  int64_t decreases() const { return decreases_; }
+
+  void on_success(int64_t latency_ms) {
+    double l = static_cast<double>(std::max<int64_t>(latency_ms, 1));
+    latency_ewma_ = (latency_ewma_ == 0.0) ? l : latency_ewma_ * 0.9 + l * 0.1;
+    // 基线: 取最小值, 并缓慢上浮以适应 gateway 的长期变化
+    baseline_ = (baseline_ == 0.0) ? l : std::min(l, baseline_ * 1.001);
+
+    if (latency_ewma_ > baseline_ * AIMD_LATENCY_FACTOR) {
+      decrease(AIMD_BACKOFF_LATENCY);
+      return;
+    }
+    window_ = std::min<double>(max_, window_ + 1.0 / window_);
+  }
+
+  // NETWORK(超时/断连)、GRAPHQL(indexer 报错/限流)、JSON(截断) 视为过载; FORMAT 与负载无关
+  void on_failure(FailureKind kind) {
+    if (kind == FailureKind::FORMAT)
+      return;
+    decrease(AIMD_BACKOFF_FAILURE);
+  }
+
+private:
+  void decrease(double factor) {
+    auto now = std::chrono::steady_clock::now();
+    auto cooldown = std::chrono::milliseconds(
+        std::max<int64_t>(AIMD_MIN_COOLDOWN_MS, static_cast<int64_t>(latency_ewma_)));
+    if (now - last_decrease_ < cooldown)
+      return;
+    last_decrease_ = now;
+    window_ = std::max<double>(AIMD_WINDOW_MIN, window_ * factor);
+    ++decreases_;
+  }
+
+  int max_;
+  double window_;
+  double latency_ewma_ = 0.0;
+  double baseline_ = 0.0;
+  int64_t decreases_ = 0;
+  std::chrono::steady_clock::time_point last_decrease_{};
+};
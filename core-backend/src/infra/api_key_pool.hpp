@@ -0,0 +1,143 @@
+#pragma once
+
+// ============================================================================
+// ApiKeyPool - 多个 gateway API key 分摊请求
+//   每个 key 独立令牌桶(rate_per_sec / burst)与在途上限, 额度互不挤占
+//   选 key: 可用者中按 剩余令牌比例 × (1 - 错误率 EWMA) × 在途余量比例 打分取最高
+//   HTTP 429: 该 key 令牌清零并冷却一段时间; 其余 4xx/5xx 与网络失败只抬高错误率
+//   只在 io 线程使用
+// ============================================================================
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../core/config.hpp"
+#include "../stats/stats_manager.hpp"
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define API_KEY_ERROR_ALPHA 0.05  // 错误率 EWMA 系数
+#define API_KEY_COOLDOWN_MS 5000  // 429 后该 key 暂停使用的时长
+
+class ApiKeyPool {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit ApiKeyPool(const std::vector<ApiKeyConfig> &configs) {
+    assert(!configs.empty() && "至少需要一个 api key");
+    auto now = clock::now();
+    for (const auto &cfg : configs)
+      keys_.push_back({cfg, static_cast<double>(cfg.burst), now, {}});
+    for (size_t i = 0; i < keys_.size(); ++i)
+      publish(i);
+  }
+
+  size_t size() const { return keys_.size(); }
+  const std::string &key(int i) const { return keys_[i].cfg.key; }
+
+  // 当前可发请求的最优 key(不扣额度); 全部不可用返回 -1
+  int pick() const {
+    auto now = clock::now();
+    int best = -1;
+    double best_score = -1.0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      const auto &k = keys_[i];
+      double tokens = tokens_at(k, now);
+      if (now < k.cooldown_until || tokens < 1.0 || k.inflight >= k.cfg.max_inflight)
+        continue;
+      double score = (tokens / k.cfg.burst) * (1.0 - k.error_rate) *
+                     (1.0 - static_cast<double>(k.inflight) / k.cfg.max_inflight);
+      if (score > best_score) {
+        best = static_cast<int>(i);
+        best_score = score;
+      }
+    }
+    return best;
+  }
+
+  // 发出请求: 扣一个令牌, 占一个在途名额
+  void acquire(int i) {
+    auto &k = keys_[i];
+    auto now = clock::now();
+    k.tokens = tokens_at(k, now) - 1.0;
+    k.refilled = now;
+    ++k.inflight;
+    ++k.requests;
+    publish(i);
+  }
+
+  // 请求结束(含对冲落败被取消的)
+  void release(int i) {
+    --keys_[i].inflight;
+    publish(i);
+  }
+
+  // 请求结果反馈; status 为 HTTP 状态码(0 = 未收到响应)
+  void record(int i, bool ok, int status) {
+    auto &k = keys_[i];
+    k.error_rate = k.error_rate * (1.0 - API_KEY_ERROR_ALPHA) + (ok ? 0.0 : API_KEY_ERROR_ALPHA);
+    if (!ok)
+      ++k.errors;
+    if (status == 429) {
+      ++k.throttled;
+      k.tokens = 0.0;
+      k.refilled = clock::now();
+      k.cooldown_until = k.refilled + std::chrono::milliseconds(API_KEY_COOLDOWN_MS);
+    }
+    publish(i);
+  }
+
+  // 最早有 key 恢复额度的等待毫秒; 所有 key 都卡在在途上限时返回 -1(等请求结束再试)
+  int64_t wait_ms() const {
+    auto now = clock::now();
+    int64_t wait = -1;
+    for (const auto &k : keys_) {
+      if (k.inflight >= k.cfg.max_inflight)
+        continue;
+      int64_t ms = 0;
+      if (now < k.cooldown_until) {
+        ms = std::chrono::duration_cast<std::chrono::milliseconds>(k.cooldown_until - now).count() + 1;
+      } else {
+        double missing = 1.0 - tokens_at(k, now);
+        if (missing > 0)
+          ms = static_cast<int64_t>(missing / k.cfg.rate_per_sec * 1000.0) + 1;
+      }
+      wait = (wait < 0) ? ms : std::min(wait, ms);
+    }
+    return wait;
+  }
+
+private:
+  struct Key {
+    ApiKeyConfig cfg;
+    double tokens;
+    clock::time_point refilled;
+    clock::time_point cooldown_until;
+    int inflight = 0;
+    double error_rate = 0.0;
+    int64_t requests = 0;
+    int64_t errors = 0;
+    int64_t throttled = 0;
+  };
+
+  static double tokens_at(const Key &k, clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - k.refilled).count();
+    return std::min<double>(k.cfg.burst, k.tokens + elapsed * k.cfg.rate_per_sec);
+  }
+
+  // 统计只暴露 key 前缀
+  void publish(size_t i) const {
+    const auto &k = keys_[i];
+    auto now = clock::now();
+    StatsManager::instance().set_api_key(
+        i, {k.cfg.key.substr(0, 8) + "...", k.cfg.rate_per_sec, tokens_at(k, now), k.inflight,
+            k.cfg.max_inflight, k.error_rate, k.requests, k.errors, k.throttled, now < k.cooldown_until});
+  }
+
+  std::vector<Key> keys_;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+// ============================================================================
+// ContentDecoder - 响应 Content-Encoding 流式解码(identity / gzip / deflate)
+// 基于 beast::zlib(纯头文件 raw inflate), gzip/zlib 头部在此解析, 尾部校验和忽略
+// (上层 JSON 解析会拒绝截断/损坏的 body)
+// ============================================================================
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <boost/beast/zlib.hpp>
+
+namespace zlib = boost::beast::zlib;
+
+#define CONTENT_INFLATE_CHUNK 65536 // 单次 inflate 输出缓冲
+
+// 单次响应的传输字节数(wire = 压缩后 body, plain = 解码后 body)
+struct TransferBytes {
+  uint64_t wire = 0;
+  uint64_t plain = 0;
+};
+
+class ContentDecoder {
+public:
+  enum class Encoding { IDENTITY, GZIP, DEFLATE };
+
+  // 按响应头 Content-Encoding 重置; 不支持的编码返回 false
+  bool reset(std::string_view content_encoding) {
+    bytes_ = {};
+    header_.clear();
+    header_done_ = false;
+    ended_ = false;
+    failed_ = false;
+
+    std::string enc;
+    for (char c : content_encoding) {
+      if (c != ' ' && c != '\t')
+        enc += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (enc.empty() || enc == "identity") {
+      encoding_ = Encoding::IDENTITY;
+    } else if (enc == "gzip" || enc == "x-gzip") {
+      encoding_ = Encoding::GZIP;
+    } else if (enc == "deflate") {
+      encoding_ = Encoding::DEFLATE;
+    } else {
+      failed_ = true;
+      return false;
+    }
+    if (encoding_ != Encoding::IDENTITY)
+      inflater_.reset();
+    return true;
+  }
+
+  Encoding encoding() const { return encoding_; }
+  const TransferBytes &bytes() const { return bytes_; }
+
+  // 喂入一段 wire 字节, 解码结果交给 sink(const char*, size_t); 出错返回 false
+  template <typename Sink>
+  bool feed(const char *data, size_t n, Sink &&sink) {
+    if (failed_)
+      return false;
+    bytes_.wire += n;
+
+    if (encoding_ == Encoding::IDENTITY) {
+      bytes_.plain += n;
+      sink(data, n);
+      return true;
+    }
+
+    if (!header_done_) {
+      header_.append(data, n);
+      size_t hlen = 0;
+      switch (parse_header(hlen)) {
+      case HeaderState::NEED_MORE:
+        return true;
+      case HeaderState::INVALID:
+        failed_ = true;
+        return false;
+      case HeaderState::DONE:
+        break;
+      }
+      header_done_ = true;
+      std::string rest = header_.substr(hlen);
+      header_.clear();
+      return inflate(rest.data(), rest.size(), sink);
+    }
+    return inflate(data, n, sink);
+  }
+
+  // body 读完: 压缩流必须已到达结束块
+  bool finish() const {
+    if (failed_)
+      return false;
+    return encoding_ == Encoding::IDENTITY || ended_;
+  }
+
+private:
+  enum class HeaderState { NEED_MORE, DONE, INVALID };
+
+  template <typename Sink>
+  bool inflate(const char *data, size_t n, Sink &sink) {
+    if (ended_ || n == 0)
+      return true; // 结束块之后是 gzip/zlib 尾部校验, 忽略
+
+    zlib::z_params zs;
+    zs.next_in = data;
+    zs.avail_in = n;
+    for (;;) {
+      zs.next_out = out_;
+      zs.avail_out = sizeof(out_);
+      boost::system::error_code ec;
+      inflater_.write(zs, zlib::Flush::sync, ec);
+      size_t produced = sizeof(out_) - zs.avail_out;
+      if (produced > 0) {
+        bytes_.plain += produced;
+        sink(out_, produced);
+      }
+      if (ec == zlib::error::end_of_stream) {
+        ended_ = true;
+        return true;
+      }
+      if (ec && ec != zlib::error::need_buffers) {
+        failed_ = true;
+        return false;
+      }
+      // 输入耗尽且输出未满: 本段已全部解码
+      if (zs.avail_in == 0 && zs.avail_out != 0)
+        return true;
+      if (produced == 0 && ec == zlib::error::need_buffers)
+        return true;
+    }
+  }
+
+  // gzip: RFC 1952 (10 字节固定头 + 可选 FEXTRA/FNAME/FCOMMENT/FHCRC)
+  // deflate: RFC 1950 zlib 头(2 字节); 不合法时按裸 deflate 处理(部分服务端如此实现)
+  HeaderState parse_header(size_t &hlen) {
+    const auto *h = reinterpret_cast<const uint8_t *>(header_.data());
+    size_t n = header_.size();
+
+    if (encoding_ == Encoding::DEFLATE) {
+      if (n < 2)
+        return HeaderState::NEED_MORE;
+      bool zlib_wrapped = (h[0] & 0x0F) == 8 && ((h[0] << 8) | h[1]) % 31 == 0;
+      if (zlib_wrapped && (h[1] & 0x20))
+        return HeaderState::INVALID; // 预置字典不支持
+      hlen = zlib_wrapped ? 2 : 0;
+      return HeaderState::DONE;
+    }
+
+    if (n < 10)
+      return HeaderState::NEED_MORE;
+    if (h[0] != 0x1F || h[1] != 0x8B || h[2] != 8)
+      return HeaderState::INVALID;
+    uint8_t flags = h[3];
+    size_t pos = 10;
+    if (flags & 0x04) { // FEXTRA
+      if (n < pos + 2)
+        return HeaderState::NEED_MORE;
+      pos += 2 + (h[pos] | (h[pos + 1] << 8));
+    }
+    for (uint8_t bit : {uint8_t{0x08}, uint8_t{0x10}}) { // FNAME, FCOMMENT: 以 0 结尾
+      if (!(flags & bit))
+        continue;
+      while (pos < n && h[pos] != 0)
+        ++pos;
+      if (pos >= n)
+        return HeaderState::NEED_MORE;
+      ++pos;
+    }
+    if (flags & 0x02) // FHCRC
+      pos += 2;
+    if (n < pos)
+      return HeaderState::NEED_MORE;
+    hlen = pos;
+    return HeaderState::DONE;
+  }
+
+  Encoding encoding_ = Encoding::IDENTITY;
+  zlib::inflate_stream inflater_;
+  std::string header_; // 头部未收全时暂存
+  bool header_done_ = false;
+  bool ended_ = false;
+  bool failed_ = false;
+  TransferBytes bytes_;
+  char out_[CONTENT_INFLATE_CHUNK];
+};
@@ -3,15 +3,27 @@
 // ============================================================================
 // 宏配置
 // ============================================================================
-#define HTTPS_POOL_SIZE 16 // 连接池大小(>= PARALLEL_TOTAL)
+#define HTTPS_POOL_SIZE 16    // 初始并发窗口 / 预热连接数(上限见 AIMD_WINDOW_MAX)
+#define HTTPS_DNS_TTL_SEC 300 // 解析结果缓存时长
+#define HTTPS_HEDGE_BUDGET 0.05 // 每个可对冲请求积累的对冲额度(约 5% 额外请求)
+#define HTTPS_HEDGE_BURST 4     // 对冲额度上限
+#define HTTPS_HEDGE_MIN_MS 300  // 对冲触发点下限
 
+#include "../stats/stats_manager.hpp"
+#include "../core/config.hpp"
+#include "../core/memory_budget.hpp"
+#include "aimd_limiter.hpp"
+#include "api_key_pool.hpp"
 #include "https_session.hpp"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -21,19 +33,117 @@ namespace ssl = asio::ssl;
 
 // ============================================================================
 // HttpsPool - HTTPS 连接池(连接复用 + 重试)
+// 建连成本: DNS 结果按 TTL 共享, TLS session ticket 跨重连复用, 启动时可预热
+// 并发上限: AIMD 窗口(首字节延时 + 失败分类驱动), 超出窗口的请求排队(排队的 body 计入 MemoryBudget)
+// 多 key: 每次发送按 ApiKeyPool 选 key(各自令牌桶 + 在途上限), 窗口上限随 key 数放大; 额度耗尽时排队等补充
+// 对冲: 可选, 主请求到点未出 body 时再发一份, 先得到可用结果(状态 < 400 且调用方解码成功)的胜出, 另一份取消
 // ============================================================================
 class HttpsPool {
 public:
-  using Callback = std::function<void(std::string)>;
+  using Callback = std::function<void(std::string)>;              // 整包响应, 失败为空串
+  using ChunkCallback = HttpsSession::ChunkCallback;               // 流式 body 分片
+  using DoneCallback = HttpsSession::Callback;                     // 流式结束 (success, 字节数)
+  using AcceptCallback = std::function<bool(const std::string &)>; // 对冲: 完整 body 是否可用(调用方在此解码)
+  using ResolveCallback = std::function<void(bool, const tcp::resolver::results_type &)>;
 
-  HttpsPool(asio::io_context &ioc, const std::string &api_key)
-      : ioc_(ioc), ssl_ctx_(ssl::context::tlsv12_client), api_key_(api_key) {
+  HttpsPool(asio::io_context &ioc, const std::vector<ApiKeyConfig> &api_keys, GatewayEndpoint endpoint = {})
+      : ioc_(ioc), ssl_ctx_(ssl::context::tlsv12_client), endpoint_(std::move(endpoint)), keys_(api_keys),
+        key_timer_(ioc), resolver_(ioc),
+        limiter_(HTTPS_POOL_SIZE * static_cast<int>(api_keys.size()),
+                 AIMD_WINDOW_MAX * static_cast<int>(api_keys.size())) {
     ssl_ctx_.set_default_verify_paths();
-    ssl_ctx_.set_verify_mode(ssl::verify_peer);
+    ssl_ctx_.set_verify_mode(endpoint_.verify ? ssl::verify_peer : ssl::verify_none);
+
+    // 客户端 session 缓存: 新 ticket 经回调存入 tls_session_, 新连接握手前挂上
+    SSL_CTX *ctx = ssl_ctx_.native_handle();
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_set_ex_data(ctx, ex_data_index(), this); // app_data 已被 asio verify 回调占用
+    SSL_CTX_sess_set_new_cb(ctx, &HttpsPool::on_new_tls_session);
+  }
+
+  ~HttpsPool() {
+    if (tls_session_)
+      SSL_SESSION_free(tls_session_);
+  }
+
+  HttpsPool(const HttpsPool &) = delete;
+  HttpsPool &operator=(const HttpsPool &) = delete;
+
+  // 启动预热: 并发建立 n 条连接放入空闲队列, 首轮 sync 不再排队握手
+  void prewarm(int n = HTTPS_POOL_SIZE) {
+    for (int i = 0; i < n; ++i) {
+      auto session = std::make_shared<HttpsSession>(ioc_, ssl_ctx_, endpoint_, this);
+      ++warming_count_;
+      session->warm();
+    }
+  }
+
+  // 预热完成(失败时 session 未连接, 直接丢弃)
+  void on_session_warmed(std::shared_ptr<HttpsSession> session) {
+    --warming_count_;
+    if (session->is_connected() && idle_sessions_.size() < HTTPS_POOL_SIZE) {
+      idle_sessions_.push(session);
+      StatsManager::instance().record_prewarmed();
+    }
+    process_pending();
+  }
+
+  // DNS 缓存: TTL 内直接返回; 过期时只发一次解析, 期间的请求排队等结果
+  void resolve(ResolveCallback cb) {
+    auto now = std::chrono::steady_clock::now();
+    if (!endpoints_.empty() && now - resolved_at_ < std::chrono::seconds(HTTPS_DNS_TTL_SEC)) {
+      StatsManager::instance().record_dns(true);
+      cb(true, endpoints_);
+      return;
+    }
+    dns_waiters_.push_back(std::move(cb));
+    if (dns_waiters_.size() > 1)
+      return;
+
+    StatsManager::instance().record_dns(false);
+    resolver_.async_resolve(
+        endpoint_.host, endpoint_.port,
+        [this](beast::error_code ec, tcp::resolver::results_type results) {
+          if (!ec) {
+            endpoints_ = std::move(results);
+            resolved_at_ = std::chrono::steady_clock::now();
+          }
+          auto waiters = std::move(dns_waiters_);
+          dns_waiters_.clear();
+          for (auto &w : waiters)
+            w(!ec, endpoints_);
+        });
+  }
+
+  // TCP 连接失败: 地址可能已变, 下次重新解析
+  void invalidate_dns() { endpoints_ = {}; }
+
+  // 握手前挂上最近的 session ticket(SSL_set_session 自增引用)
+  void apply_tls_session(SSL *ssl) {
+    if (tls_session_)
+      SSL_set_session(ssl, tls_session_);
   }
 
   void async_post(const std::string &target, const std::string &body, Callback cb) {
-    do_request(target, body, std::move(cb));
+    auto response = std::make_shared<std::string>();
+    do_request(
+        target, body,
+        [response](const char *data, size_t n) { response->append(data, n); },
+        [response, cb = std::move(cb)](bool success, const TransferBytes &) {
+          cb(success ? std::move(*response) : std::string());
+        });
+  }
+
+  // 流式请求: body 分片到达(已解压)即回调 on_chunk, 结束时回调 on_done(success, 字节数)
+  // 失败前可能已交付部分分片, 由调用方丢弃
+  // hedge_after_ms > 0 且给了 accept: 开始发送后该时长内未完成则对冲; 对冲请求不流式,
+  //   每份缓冲完整 body 后交 accept 判定(不调用 on_chunk), 一份不可用时等另一份, 都不可用时交付最后一份
+  void async_post_stream(const std::string &target, const std::string &body,
+                         ChunkCallback on_chunk, DoneCallback on_done, int64_t hedge_after_ms = 0,
+                         AcceptCallback accept = {}) {
+    if (!accept)
+      hedge_after_ms = 0;
+    do_request(target, body, std::move(on_chunk), std::move(on_done), hedge_after_ms, std::move(accept));
   }
 
   void return_session(std::shared_ptr<HttpsSession> session) {
@@ -44,13 +154,34 @@ public:
     process_pending();
   }
 
-  void on_request_failed(Callback cb) {
+  // cancelled: 对冲落败被主动取消, 不计入并发窗口
+  void on_request_failed(DoneCallback cb, const TransferBytes &bytes, bool cancelled) {
     --active_count_;
-    cb("");
+    if (!cancelled)
+      limiter_.on_failure(FailureKind::NETWORK);
+    cb(false, bytes);
     process_pending();
   }
 
   int active_count() const { return active_count_; }
+  int window() const { return limiter_.limit(); }
+
+  // 并发窗口反馈: 首字节延时(session 上报) / 响应层失败(执行器按 FailureKind 上报)
+  void report_latency(int64_t latency_ms) {
+    limiter_.on_success(latency_ms);
+    publish_window();
+  }
+
+  void report_failure(FailureKind kind) {
+    limiter_.on_failure(kind);
+    publish_window();
+  }
+
+  // 在连接池的 io_context 上延后执行(用于同一 tick 内的请求合批)
+  template <typename Func>
+  void post(Func &&func) {
+    asio::post(ioc_, std::forward<Func>(func));
+  }
 
   // 延迟执行回调(用于重试)
   template <typename Func>
@@ -66,55 +197,214 @@ private:
   struct PendingRequest {
     std::string target;
     std::string body;
-    Callback cb;
+    ChunkCallback on_chunk;
+    DoneCallback cb;
+    int64_t hedge_after_ms;
+    AcceptCallback accept;
+  };
+
+  // 一次可对冲请求: attempts[0] 为主请求, attempts[1] 为对冲; 各自缓冲 body
+  struct HedgeState {
+    AcceptCallback accept;
+    DoneCallback cb;
+    std::shared_ptr<HttpsSession> attempts[2];
+    std::string bodies[2];
+    int winner = -1;
+    int outstanding = 0;
+    std::unique_ptr<asio::steady_timer> timer;
   };
 
   void do_request(const std::string &target, const std::string &body,
-                  Callback cb) {
-    if (active_count_ < HTTPS_POOL_SIZE) {
-      start_request(target, body, std::move(cb));
+                  ChunkCallback on_chunk, DoneCallback cb, int64_t hedge_after_ms = 0,
+                  AcceptCallback accept = {}) {
+    if (can_start()) {
+      start_request(target, body, std::move(on_chunk), std::move(cb), hedge_after_ms, std::move(accept));
     } else {
-      pending_.push({target, body, std::move(cb)});
+      MemoryBudget::instance().acquire(body.size()); // 排队期间 body 计入内存预算
+      pending_.push({target, body, std::move(on_chunk), std::move(cb), hedge_after_ms, std::move(accept)});
     }
   }
 
+  // 计时从真正发出开始(排队时间不算), 到点时仍需预算与窗口余量才发对冲
   void start_request(const std::string &target, const std::string &body,
-                     Callback cb) {
+                     ChunkCallback on_chunk, DoneCallback cb, int64_t hedge_after_ms, AcceptCallback accept) {
+    if (hedge_after_ms <= 0) {
+      start_attempt(target, body, std::move(on_chunk), std::move(cb));
+      return;
+    }
+    hedge_tokens_ = std::min<double>(HTTPS_HEDGE_BURST, hedge_tokens_ + HTTPS_HEDGE_BUDGET);
+
+    auto hs = std::make_shared<HedgeState>();
+    hs->accept = std::move(accept);
+    hs->cb = std::move(cb);
+    hs->timer = std::make_unique<asio::steady_timer>(ioc_);
+    start_hedge_attempt(hs, 0, target, body);
+
+    hs->timer->expires_after(std::chrono::milliseconds(std::max<int64_t>(hedge_after_ms, HTTPS_HEDGE_MIN_MS)));
+    hs->timer->async_wait([this, hs, target, body](boost::system::error_code ec) {
+      if (ec || hs->winner >= 0 || hs->outstanding == 0)
+        return;
+      if (hedge_tokens_ < 1.0 || !can_start()) {
+        StatsManager::instance().record_hedge_denied();
+        return;
+      }
+      hedge_tokens_ -= 1.0;
+      StatsManager::instance().record_hedge_sent();
+      start_hedge_attempt(hs, 1, target, body);
+    });
+  }
+
+  // 完成且可用(状态 < 400, accept 为真)的第一份胜出; 不可用的一份在另一份仍在途时放弃,
+  // 两份都不可用时交付最后完成的一份(HTTP 错误体也交 accept, 由调用方按内容归类失败)
+  void start_hedge_attempt(const std::shared_ptr<HedgeState> &hs, int i,
+                           const std::string &target, const std::string &body) {
+    ++hs->outstanding;
+    hs->bodies[i].clear();
+    hs->attempts[i] = start_attempt(
+        target, body, [hs, i](const char *data, size_t n) { hs->bodies[i].append(data, n); },
+        [this, hs, i](bool success, const TransferBytes &bytes) {
+          --hs->outstanding;
+          int status = hs->attempts[i] ? hs->attempts[i]->status() : 0;
+          hs->attempts[i].reset();
+          if (hs->winner >= 0) // 落败被取消
+            return;
+          bool usable = success && status < 400;
+          if (usable && hs->accept(hs->bodies[i])) {
+            decide_hedge(*hs, i);
+          } else if (hs->outstanding > 0) {
+            hs->bodies[i].clear();
+            return;
+          } else {
+            if (success && !usable)
+              hs->accept(hs->bodies[i]);
+            hs->winner = i;
+            hs->timer->cancel();
+          }
+          auto cb = std::move(hs->cb);
+          hs->bodies[0].clear();
+          hs->bodies[1].clear();
+          cb(success, bytes);
+        });
+  }
+
+  void decide_hedge(HedgeState &hs, int i) {
+    hs.winner = i;
+    hs.timer->cancel();
+    if (auto &loser = hs.attempts[1 - i])
+      loser->cancel();
+    if (i == 1)
+      StatsManager::instance().record_hedge_won();
+  }
+
+  // 调用方已经 can_start() 确认有可用 key
+  std::shared_ptr<HttpsSession> start_attempt(const std::string &target, const std::string &body,
+                                              ChunkCallback on_chunk, DoneCallback cb) {
     ++active_count_;
+    int key = keys_.pick();
+    assert(key >= 0);
+    keys_.acquire(key);
 
     std::shared_ptr<HttpsSession> session;
     if (!idle_sessions_.empty()) {
       session = idle_sessions_.front();
       idle_sessions_.pop();
     } else {
-      session = std::make_shared<HttpsSession>(ioc_, ssl_ctx_, api_key_, this);
+      session = std::make_shared<HttpsSession>(ioc_, ssl_ctx_, endpoint_, this);
     }
 
-    session->run(target, body,
-                 [this, cb = std::move(cb)](std::string response, bool success) mutable {
+    HttpsSession *raw = session.get(); // 回调期间 session 必然存活
+    session->run(target, body, keys_.key(key), std::move(on_chunk),
+                 [this, raw, key, cb = std::move(cb)](bool success, const TransferBytes &bytes) mutable {
+                   keys_.release(key);
+                   if (!raw->cancelled())
+                     keys_.record(key, success && raw->status() < 400, raw->status());
                    if (success) {
-                     cb(std::move(response));
+                     cb(true, bytes);
                    } else {
-                     on_request_failed(std::move(cb));
+                     on_request_failed(std::move(cb), bytes, raw->cancelled());
                    }
                  });
+    return session;
+  }
+
+  // 预热中的连接计入名额: 有空闲连接直接用, 否则只在不会超过窗口时新建; 另需某个 key 有额度
+  bool can_start() const {
+    int limit = limiter_.limit();
+    if (active_count_ >= limit)
+      return false;
+    if (idle_sessions_.empty() && active_count_ + warming_count_ >= limit)
+      return false;
+    return keys_.pick() >= 0;
   }
 
   void process_pending() {
-    while (!pending_.empty() && active_count_ < HTTPS_POOL_SIZE) {
+    while (!pending_.empty() && can_start()) {
       auto req = std::move(pending_.front());
       pending_.pop();
-      start_request(req.target, req.body, std::move(req.cb));
+      MemoryBudget::instance().release(req.body.size());
+      start_request(req.target, req.body, std::move(req.on_chunk), std::move(req.cb), req.hedge_after_ms,
+                    std::move(req.accept));
     }
+    if (!pending_.empty())
+      arm_key_timer();
+    publish_window();
+  }
+
+  // 仅因 key 额度(令牌/冷却)卡住时定时唤醒; 卡在窗口或在途上限时由请求完成触发
+  void arm_key_timer() {
+    if (key_timer_armed_ || keys_.pick() >= 0)
+      return;
+    int64_t ms = keys_.wait_ms();
+    if (ms < 0)
+      return;
+    key_timer_armed_ = true;
+    key_timer_.expires_after(std::chrono::milliseconds(ms));
+    key_timer_.async_wait([this](boost::system::error_code) {
+      key_timer_armed_ = false;
+      process_pending();
+    });
+  }
+
+  void publish_window() {
+    StatsManager::instance().set_pool_window(
+        limiter_.window(), active_count_, static_cast<int>(pending_.size()),
+        limiter_.latency_ewma_ms(), limiter_.baseline_ms(), limiter_.decreases());
+  }
+
+  static int ex_data_index() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+  }
+
+  // OpenSSL 新 session 回调(TLS 1.3 ticket 在握手后到达); 返回 1 = 接管引用
+  static int on_new_tls_session(SSL *ssl, SSL_SESSION *session) {
+    auto *self = static_cast<HttpsPool *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ex_data_index()));
+    if (self->tls_session_)
+      SSL_SESSION_free(self->tls_session_);
+    self->tls_session_ = session;
+    return 1;
   }
 
   // 配置
   asio::io_context &ioc_;
   ssl::context ssl_ctx_;
-  std::string api_key_;
+  GatewayEndpoint endpoint_;
+  ApiKeyPool keys_;
+  asio::steady_timer key_timer_;
+  bool key_timer_armed_ = false;
+
+  // 建连缓存
+  tcp::resolver resolver_;
+  tcp::resolver::results_type endpoints_;
+  std::chrono::steady_clock::time_point resolved_at_;
+  std::vector<ResolveCallback> dns_waiters_;
+  SSL_SESSION *tls_session_ = nullptr;
 
   // 状态
+  AimdLimiter limiter_;
+  double hedge_tokens_ = HTTPS_HEDGE_BURST;
   int active_count_ = 0;
+  int warming_count_ = 0;
   std::queue<PendingRequest> pending_;
   std::queue<std::shared_ptr<HttpsSession>> idle_sessions_;
 };
@@ -123,11 +413,56 @@ private:
 // HttpsSession 成员函数实现(需要 HttpsPool 完整定义)
 // ============================================================================
 
+inline void HttpsSession::start_connect() {
+  SSL_set_tlsext_host_name(stream_.native_handle(), endpoint_.host.c_str());
+  pool_->resolve([self = shared_from_this()](bool ok, const tcp::resolver::results_type &results) {
+    if (!ok || self->cancelled_) {
+      self->fail("DNS resolve");
+      return;
+    }
+    self->pool_->apply_tls_session(self->stream_.native_handle());
+    self->on_resolve(results);
+  });
+}
+
+// TCP 连接失败: 缓存的地址可能已失效
+inline void HttpsSession::on_connect_failed() {
+  pool_->invalidate_dns();
+  fail("TCP connect");
+}
+
+inline void HttpsSession::on_handshake() {
+  StatsManager::instance().record_tls_handshake(SSL_session_reused(stream_.native_handle()) == 1);
+  if (warming_) {
+    warming_ = false;
+    pool_->on_session_warmed(shared_from_this());
+    return;
+  }
+  if (cancelled_) {
+    fail("SSL handshake");
+    return;
+  }
+  do_write();
+}
+
+inline void HttpsSession::on_first_byte() {
+  pool_->report_latency(std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - written_at_)
+                            .count());
+}
+
 inline void HttpsSession::fail(const char *what) {
-  std::cerr << "[HTTPS] " << what << " failed" << std::endl;
+  if (!cancelled_)
+    std::cerr << "[HTTPS] " << what << " failed" << std::endl;
   connected_ = false;
+  if (warming_) {
+    warming_ = false;
+    pool_->on_session_warmed(shared_from_this());
+    return;
+  }
   auto cb = std::move(cb_);
-  cb("", false);
+  on_chunk_ = nullptr;
+  cb(false, decoder_.bytes());
 }
 
 inline void HttpsSession::return_to_pool() {
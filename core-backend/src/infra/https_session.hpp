@@ -6,9 +6,13 @@
 #define HTTPS_TIMEOUT_SEC 30 // 请求超时
 #define HTTPS_HOST "gateway.thegraph.com"
 #define HTTPS_PORT "443"
+#define HTTPS_READ_CHUNK 65536 // 流式读取单次 body 分片上限
+#define HTTPS_ACCEPT_ENCODING "gzip, deflate" // 空串 = 不协商压缩
 
 #include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include <boost/asio.hpp>
@@ -16,6 +20,8 @@
 #include <boost/beast.hpp>
 #include <boost/beast/ssl.hpp>
 
+#include "content_decoder.hpp"
+
 namespace asio = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -24,44 +30,68 @@ using tcp = asio::ip::tcp;
 
 class HttpsPool;
 
+// gateway 地址: 默认 The Graph; 基准可指向本地 mock (verify = false 接受自签证书)
+struct GatewayEndpoint {
+  std::string host = HTTPS_HOST;
+  std::string port = HTTPS_PORT;
+  bool verify = true;
+};
+
 // ============================================================================
 // HttpsSession - 可复用的 HTTPS 连接会话
+// 响应 body 以分片形式流式交付(buffer_body + read_some), 边收边解压边解析
 // ============================================================================
 class HttpsSession : public std::enable_shared_from_this<HttpsSession> {
 public:
-  using Callback = std::function<void(std::string, bool)>; // (response, success)
+  using ChunkCallback = std::function<void(const char *, size_t)>;     // 解码后 body 分片
+  using Callback = std::function<void(bool, const TransferBytes &)>; // (success, 本次字节数)
 
-  HttpsSession(asio::io_context &ioc, ssl::context &ssl_ctx,
-               const std::string &api_key, HttpsPool *pool)
-      : resolver_(ioc), stream_(ioc, ssl_ctx), api_key_(api_key), pool_(pool) {}
+  HttpsSession(asio::io_context &ioc, ssl::context &ssl_ctx, const GatewayEndpoint &endpoint, HttpsPool *pool)
+      : stream_(ioc, ssl_ctx), endpoint_(endpoint), pool_(pool) {}
 
-  void run(const std::string &target, const std::string &body, Callback cb) {
+  // api_key 按请求指定: 连接在多个 key 之间复用
+  void run(const std::string &target, const std::string &body, const std::string &api_key,
+           ChunkCallback on_chunk, Callback cb) {
+    on_chunk_ = std::move(on_chunk);
     cb_ = std::move(cb);
     target_ = target;
     body_ = body;
+    api_key_ = api_key;
+    status_ = 0;
+    decoder_.reset({});
 
     if (connected_) {
       do_write();
     } else {
-      SSL_set_tlsext_host_name(stream_.native_handle(), HTTPS_HOST);
-      resolver_.async_resolve(
-          HTTPS_HOST, HTTPS_PORT,
-          [self = shared_from_this()](beast::error_code ec, tcp::resolver::results_type results) {
-            if (ec) {
-              self->fail("DNS resolve");
-              return;
-            }
-            self->on_resolve(results);
-          });
+      start_connect();
     }
   }
 
+  // 预热: 只建连(DNS + TCP + TLS), 完成后交回连接池空闲队列
+  void warm() {
+    warming_ = true;
+    start_connect();
+  }
+
   bool is_connected() const { return connected_; }
+  int status() const { return status_; } // 本次请求的 HTTP 状态码, 未收到响应头为 0
   void mark_disconnected() { connected_ = false; }
 
+  // 对冲落败: 连接作废, 进行中的异步操作以 operation_aborted 结束并走 fail()
+  void cancel() {
+    cancelled_ = true;
+    connected_ = false;
+    beast::get_lowest_layer(stream_).cancel();
+  }
+  bool cancelled() const { return cancelled_; }
+
 private:
   void fail(const char *what);
   void return_to_pool();
+  void start_connect(); // 经连接池 DNS 缓存解析
+  void on_connect_failed();
+  void on_handshake();  // 记录 TLS 复用, 预热连接交回连接池
+  void on_first_byte(); // 首字节延时交给连接池并发窗口
 
   // ========================================================================
   // 连接建立流程
@@ -73,13 +103,14 @@ private:
         results,
         [self = shared_from_this()](beast::error_code ec, tcp::endpoint) {
           if (ec) {
-            self->fail("TCP connect");
+            self->on_connect_failed();
             return;
           }
           self->on_connect();
         });
   }
 
+  // 握手前由连接池挂上缓存的 TLS session(若有), 服务端接受则走简化握手
   void on_connect() {
     beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(HTTPS_TIMEOUT_SEC));
     stream_.async_handshake(
@@ -90,7 +121,7 @@ private:
             return;
           }
           self->connected_ = true;
-          self->do_write();
+          self->on_handshake();
         });
   }
 
@@ -100,16 +131,19 @@ private:
 
   void do_write() {
     req_ = {};
-    res_ = {};
+    parser_.emplace();
+    parser_->body_limit(std::numeric_limits<std::uint64_t>::max());
     buffer_.clear();
 
     req_.method(http::verb::post);
     req_.target(target_);
     req_.version(11);
-    req_.set(http::field::host, HTTPS_HOST);
+    req_.set(http::field::host, endpoint_.host);
     req_.set(http::field::content_type, "application/json");
     req_.set(http::field::authorization, "Bearer " + api_key_);
     req_.set(http::field::connection, "keep-alive");
+    if (HTTPS_ACCEPT_ENCODING[0] != '\0')
+      req_.set(http::field::accept_encoding, HTTPS_ACCEPT_ENCODING);
     req_.body() = body_;
     req_.prepare_payload();
 
@@ -127,38 +161,88 @@ private:
   }
 
   void on_write() {
+    written_at_ = std::chrono::steady_clock::now();
     beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(HTTPS_TIMEOUT_SEC));
-    http::async_read(
-        stream_, buffer_, res_,
+    http::async_read_header(
+        stream_, buffer_, *parser_,
         [self = shared_from_this()](beast::error_code ec, std::size_t) {
           if (ec) {
             self->connected_ = false;
             self->fail("HTTP read");
             return;
           }
-          self->on_read();
+          self->status_ = static_cast<int>(self->parser_->get().result_int());
+          if (!self->decoder_.reset(self->parser_->get()[http::field::content_encoding])) {
+            self->connected_ = false; // body 未读, 连接不可复用
+            self->fail("Content-Encoding");
+            return;
+          }
+          self->on_first_byte();
+          self->read_body();
+        });
+  }
+
+  // 逐片读取 body: 每片解压后交给 on_chunk_, 解析与后续网络接收重叠
+  void read_body() {
+    if (parser_->is_done()) {
+      on_read();
+      return;
+    }
+    auto &body = parser_->get().body();
+    body.data = chunk_;
+    body.size = sizeof(chunk_);
+    http::async_read_some(
+        stream_, buffer_, *parser_,
+        [self = shared_from_this()](beast::error_code ec, std::size_t) {
+          if (ec && ec != http::error::need_buffer) {
+            self->connected_ = false;
+            self->fail("HTTP read");
+            return;
+          }
+          size_t n = sizeof(self->chunk_) - self->parser_->get().body().size;
+          if (n > 0 && !self->decoder_.feed(self->chunk_, n, self->on_chunk_)) {
+            self->connected_ = false;
+            self->fail("content decode");
+            return;
+          }
+          self->read_body();
         });
   }
 
   void on_read() {
-    cb_(res_.body(), true);
+    if (!parser_->get().keep_alive())
+      connected_ = false;
+    if (!decoder_.finish()) {
+      fail("content decode"); // 压缩流未结束: body 截断
+      return;
+    }
+    auto cb = std::move(cb_);
+    on_chunk_ = nullptr;
+    cb(true, decoder_.bytes());
     return_to_pool();
   }
 
   // 网络组件
-  tcp::resolver resolver_;
   beast::ssl_stream<beast::tcp_stream> stream_;
   beast::flat_buffer buffer_;
   http::request<http::string_body> req_;
-  http::response<http::string_body> res_;
+  std::optional<http::response_parser<http::buffer_body>> parser_;
+  char chunk_[HTTPS_READ_CHUNK];
+  ContentDecoder decoder_;
 
   // 配置
-  std::string api_key_;
+  const GatewayEndpoint &endpoint_; // 连接池持有
   HttpsPool *pool_;
 
   // 请求状态
   std::string target_;
   std::string body_;
+  std::string api_key_;
+  int status_ = 0;
+  ChunkCallback on_chunk_;
   Callback cb_;
+  std::chrono::steady_clock::time_point written_at_;
   bool connected_ = false;
+  bool warming_ = false;
+  bool cancelled_ = false;
 };
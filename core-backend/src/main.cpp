@@ -1,26 +1,80 @@
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "api/api_server.hpp"
+#include "core/bulk_import.hpp"
 #include "core/config.hpp"
 #include "core/database.hpp"
+#include "core/ingest_writer.hpp"
+#include "core/memory_budget.hpp"
 #include "infra/https_pool.hpp"
 #include "rebuild/rebuilder.hpp"
+#include "sync/page_archive.hpp"
 #include "sync/sync_incremental_coordinator.hpp"
 #include "sync/sync_token_filler.hpp"
 
 void print_usage(const char *prog) {
   std::cout << "用法: " << prog << " --config <config.json>" << std::endl;
+  std::cout << "      " << prog << " --config <config.json> --reingest <archive_dir> [--db <path>]" << std::endl;
+  std::cout << "        离线重灌: 归档段文件回放进 db(默认 config 的 db_path, 建议新库), 不联网" << std::endl;
+  std::cout << "      " << prog << " --config <config.json> --import <table>=<file|glob> [--import ...]" << std::endl;
+  std::cout << "        批量导入 JSONL/Parquet 转储(.parquet 结尾按 Parquet, 否则按 JSONL), 游标推进到转储高水位" << std::endl;
+}
+
+// 批量导入: 按参数顺序逐表导入, 完成即退出
+int run_import(const Config &config, const std::vector<std::string> &args) {
+  Database db(config.db_path);
+  db.init_sync_state();
+  bool ok = true;
+  for (const auto &arg : args) {
+    auto spec = bulk_import::parse_spec(arg);
+    if (!spec.entity) {
+      std::cerr << "[Import] 未知表或格式错误(应为 <table>=<path>): " << arg << std::endl;
+      ok = false;
+      continue;
+    }
+    ok = bulk_import::run(db, config, spec) && ok;
+  }
+  return ok ? 0 : 1;
+}
+
+// 离线重灌: 只读本地段文件, 完成即退出
+int run_reingest(const std::string &archive_dir, const std::string &db_path) {
+  std::cout << "[Reingest] " << archive_dir << " → " << db_path << std::endl;
+  Database db(db_path);
+  auto t0 = std::chrono::steady_clock::now();
+  auto stats = page_archive::Reingester(db).run(archive_dir);
+  auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "[Reingest] done: " << stats.segments << " segments, " << stats.bodies << " bodies, "
+            << stats.pages << " pages, " << stats.rows << " rows (" << stats.bad_bodies << " bad bodies) in "
+            << secs << "s" << std::endl;
+  if (!stats.error.empty()) {
+    std::cerr << "[Reingest] aborted: " << stats.error << std::endl;
+    return 1;
+  }
+  return 0;
 }
 
 int main(int argc, char *argv[]) {
   std::string config_path = "config.json";
+  std::string reingest_dir;
+  std::string db_override;
+  std::vector<std::string> imports;
 
   for (int i = 1; i < argc; ++i) {
     if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
       config_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--reingest") == 0 && i + 1 < argc) {
+      reingest_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+      imports.push_back(argv[++i]);
+    } else if (std::strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+      db_override = argv[++i];
     } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
       print_usage(argv[0]);
       return 0;
@@ -32,8 +86,18 @@ int main(int argc, char *argv[]) {
   std::cout << "========================================" << std::endl;
 
   Config config = Config::load(config_path);
+  if (!db_override.empty())
+    config.db_path = db_override;
+
+  if (!reingest_dir.empty())
+    return run_reingest(reingest_dir, config.db_path);
+  if (!imports.empty())
+    return run_import(config, imports);
 
-  std::cout << "[Main] API Key: " << config.api_key.substr(0, 8) << "..." << std::endl;
+  for (const auto &k : config.api_keys) {
+    std::cout << "[Main] API Key: " << k.key.substr(0, 8) << "... (" << k.rate_per_sec << " req/s, burst "
+              << k.burst << ", inflight " << k.max_inflight << ")" << std::endl;
+  }
   std::cout << "[Main] DB Path: " << config.db_path << std::endl;
   std::cout << "[Main] Sync Interval: " << config.sync_interval_seconds << "s" << std::endl;
   std::cout << "[Main] Active Sources: " << config.sources.size() << std::endl;
@@ -46,8 +110,18 @@ int main(int argc, char *argv[]) {
   asio::io_context ioc_api;  // API 专用
   asio::io_context ioc_sync; // sync + HTTPS 专用
 
-  // HTTPS 连接池
-  HttpsPool pool(ioc_sync, config.api_key);
+  // HTTPS 连接池 (预热: ioc_sync 启动后并发建连)
+  GatewayEndpoint endpoint;
+  if (!config.gateway.empty()) {
+    auto colon = config.gateway.rfind(':');
+    endpoint.host = config.gateway.substr(0, colon);
+    endpoint.port = colon == std::string::npos ? "443" : config.gateway.substr(colon + 1);
+    endpoint.verify = config.gateway_verify;
+    std::cout << "[Main] Gateway: " << endpoint.host << ":" << endpoint.port
+              << (endpoint.verify ? "" : " (不校验证书)") << std::endl;
+  }
+  HttpsPool pool(ioc_sync, config.api_keys, endpoint);
+  pool.prewarm();
 
   // Token ID 填充 (手动触发)
   SyncTokenFiller token_filler(db, pool, config);
@@ -58,8 +132,24 @@ int main(int argc, char *argv[]) {
   // HTTP 服务器 (查询 API) — 独立线程, 不被 sync 阻塞
   ApiServer api_server(ioc_api, db, token_filler, rebuild_engine, 8001);
 
+  // sync 链路内存预算 (在途页 / 待落盘页 / 排队请求)
+  if (config.ingest_memory_mb > 0)
+    MemoryBudget::instance().set_limit(static_cast<size_t>(config.ingest_memory_mb) * 1024 * 1024);
+  std::cout << "[Main] Ingest memory budget: " << MemoryBudget::instance().limit() / (1024 * 1024) << " MB"
+            << std::endl;
+
+  // 写库线程 (拉取与落盘并行)
+  IngestWriter writer(db, ioc_sync);
+
+  // 响应归档 (可选)
+  std::unique_ptr<PageArchive> archive;
+  if (!config.archive_dir.empty()) {
+    archive = std::make_unique<PageArchive>(config.archive_dir, ioc_sync);
+    std::cout << "[Main] Archive: " << config.archive_dir << std::endl;
+  }
+
   // 数据拉取 (周期性增量 sync)
-  SyncIncrementalCoordinator sync_coordinator(config, db, pool);
+  SyncIncrementalCoordinator sync_coordinator(config, db, pool, writer, archive.get());
   sync_coordinator.start(ioc_sync);
 
   std::thread api_thread([&ioc_api]() { ioc_api.run(); });
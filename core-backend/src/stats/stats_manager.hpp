@@ -1,13 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -60,6 +63,18 @@ struct EntityStat {
   int64_t fail_graphql = 0;
   int64_t fail_format = 0;
 
+  // 传输字节(不持久化): wire = 压缩后响应 body, plain = 解压后
+  int64_t bytes_compressed = 0;
+  int64_t bytes_uncompressed = 0;
+
+  // 自适应分页: 当前 first:(0 = 未请求过)
+  int page_size = 0;
+
+  // 冷启动回填: 未完成的时间分片数(0 = 无回填)
+  int backfill_shards = 0;
+  // 全量重拉: 未完成的 id 分片数(0 = 不在重拉中)
+  int refresh_shards = 0;
+
   // 状态
   bool is_syncing = false;
   bool sync_done = false;
@@ -70,6 +85,71 @@ struct EntityStat {
   std::chrono::steady_clock::time_point last_persist;
 };
 
+// ============================================================================
+// 单个 API key 的配额与结果(ApiKeyPool 推送, 不持久化)
+// ============================================================================
+struct ApiKeyStat {
+  std::string label;          // key 前缀
+  double rate_per_sec = 0;    // 令牌补充速率
+  double tokens = 0;          // 当前令牌
+  int inflight = 0;           // 在途请求
+  int max_inflight = 0;       // 在途上限
+  double error_rate = 0;      // 错误率 EWMA
+  int64_t requests = 0;       // 已发请求
+  int64_t errors = 0;         // 网络失败 / HTTP 4xx 5xx
+  int64_t throttled = 0;      // 其中 429
+  bool cooling = false;       // 429 后冷却中
+};
+
+// ============================================================================
+// HTTPS 连接池统计(全局单份, 不持久化)
+// ============================================================================
+struct PoolStat {
+  int64_t dns_lookups = 0;    // 实际 DNS 解析次数
+  int64_t dns_cache_hits = 0; // 命中缓存的解析请求
+  int64_t tls_handshakes = 0; // 完成的 TLS 握手
+  int64_t tls_resumed = 0;    // 其中复用 session ticket 的
+  int64_t prewarmed = 0;      // 启动预热成功的连接
+  double window = 0;          // AIMD 并发窗口
+  int inflight = 0;           // 在途请求
+  int pending = 0;            // 排队请求
+  double latency_ewma_ms = 0; // 请求延时 EWMA
+  double latency_base_ms = 0; // 延时基线(近期最小)
+  int64_t window_decreases = 0;
+  int64_t hedges_sent = 0;    // 对冲请求
+  int64_t hedges_won = 0;     // 其中先于主请求响应的
+  int64_t hedges_denied = 0;  // 到点但预算/窗口不足未发的
+  std::vector<ApiKeyStat> keys; // 按 config 中 key 顺序
+};
+
+// ============================================================================
+// 写库线程统计(全局单份, 不持久化)
+// ============================================================================
+struct WriterStat {
+  int64_t queue_depth = 0;     // 排队 + 写入中的页数
+  int64_t max_queue_depth = 0; // 峰值
+  int64_t stalls = 0;          // 因队列满暂停拉取的次数
+  int64_t commits = 0;         // 已提交事务数
+  int64_t pages = 0;           // 已提交页数(组提交: 每事务 1..GROUP_COMMIT_MAX_PAGES 页)
+  int64_t last_group = 0;      // 最近一次事务的页数
+  int64_t max_group = 0;       // 单事务页数峰值
+  int64_t group_hist[4] = {};  // 事务页数分布: 1 / 2-3 / 4-7 / 8+
+  int64_t rows = 0;            // 已提交行数
+  int64_t commit_ms = 0;       // 累计提交耗时
+  int64_t failed_pages = 0;    // 写库失败(未落盘, 游标未推进)的页数
+};
+
+// ============================================================================
+// sync 内存预算统计(全局单份, 不持久化)
+// ============================================================================
+struct MemoryStat {
+  int64_t limit = 0;   // 上限字节
+  int64_t used = 0;    // 当前占用(在途页预估 / 待落盘列缓冲 / 排队请求 body)
+  int64_t peak = 0;    // 占用峰值
+  int64_t stalls = 0;  // 额度不足暂停拉取的次数
+  int64_t waiting = 0; // 当前等待额度的生产方数
+};
+
 // ============================================================================
 // 全局 Stats 管理器
 // ============================================================================
@@ -85,6 +165,13 @@ public:
     db_ = db;
   }
 
+  // 统计落盘 SQL 的执行方(写库线程注册, 析构时清空); 未注册时同步执行(启动/离线工具)
+  using PersistFunc = std::function<void(std::string sql)>;
+  void set_persister(PersistFunc persister) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    persister_ = std::move(persister);
+  }
+
   // 获取指定 entity(跨 source 汇总)的 count
   // found=true 表示至少存在一个 source/entity 的统计项(即已经 init 过)
   int64_t get_total_count_for_entity(const std::string &entity, bool *found = nullptr) {
@@ -115,8 +202,9 @@ public:
     stat.last_update = std::chrono::steady_clock::now();
     stat.last_persist = stat.last_update;
 
-    // 从数据库加载历史统计
+    // 从数据库加载历史统计(含 indexer 失败计数: 运行中 io 线程记失败时不再读库)
     load_from_db(stat);
+    load_indexer_fails_from_db(source, entity);
   }
 
   // 开始同步
@@ -131,16 +219,63 @@ public:
 
   // 完成同步
   void end_sync(const std::string &source, const std::string &entity) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto key = make_key(source, entity);
-    if (stats_.count(key)) {
-      auto &stat = stats_[key];
-      stat.is_syncing = false;
-      stat.sync_done = true;
-      stat.api_state = ApiState::IDLE;
-      save_to_db(stat); // 结束时强制落盘
-      stat.last_persist = std::chrono::steady_clock::now();
+    std::string sql;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto key = make_key(source, entity);
+      if (stats_.count(key)) {
+        auto &stat = stats_[key];
+        stat.is_syncing = false;
+        stat.sync_done = true;
+        stat.api_state = ApiState::IDLE;
+        sql = persist_sql(stat); // 结束时强制落盘
+        stat.last_persist = std::chrono::steady_clock::now();
+      }
     }
+    persist(sql);
+  }
+
+  void record_transfer(const std::string &source, const std::string &entity, uint64_t wire, uint64_t plain) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &stat = stats_[make_key(source, entity)];
+    stat.bytes_compressed += static_cast<int64_t>(wire);
+    stat.bytes_uncompressed += static_cast<int64_t>(plain);
+  }
+
+  void set_page_size(const std::string &source, const std::string &entity, int page_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[make_key(source, entity)].page_size = page_size;
+  }
+
+  // 覆盖记录数(全量重拉换表后以新表为准)
+  void set_count(const std::string &source, const std::string &entity, int64_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[make_key(source, entity)].count = count;
+  }
+
+  // 回填分片数(分片规划/恢复时设置, 每个分片追平后减一)
+  void set_backfill_shards(const std::string &source, const std::string &entity, int shards) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[make_key(source, entity)].backfill_shards = shards;
+  }
+
+  void finish_backfill_shard(const std::string &source, const std::string &entity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &stat = stats_[make_key(source, entity)];
+    if (stat.backfill_shards > 0)
+      --stat.backfill_shards;
+  }
+
+  void set_refresh_shards(const std::string &source, const std::string &entity, int shards) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[make_key(source, entity)].refresh_shards = shards;
+  }
+
+  void finish_refresh_shard(const std::string &source, const std::string &entity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &stat = stats_[make_key(source, entity)];
+    if (stat.refresh_shards > 0)
+      --stat.refresh_shards;
   }
 
   // 设置API状态
@@ -155,54 +290,224 @@ public:
   // 记录成功的请求(latency_ms是纯API调用时间，不含本地处理)
   void record_success(const std::string &source, const std::string &entity,
                       int64_t records, int64_t latency_ms) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto &stat = stats_[make_key(source, entity)];
+    std::string sql;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto &stat = stats_[make_key(source, entity)];
 
-    stat.count += records;
-    stat.success_requests++;
-    stat.total_rows_synced += records;
+      stat.count += records;
+      stat.success_requests++;
+      stat.total_rows_synced += records;
 
-    update_after_request(stat, latency_ms);
+      sql = update_after_request(stat, latency_ms);
+    }
+    persist(sql);
   }
 
   // 记录失败的请求(latency_ms是纯API调用时间，不含本地处理)
   void record_failure(const std::string &source, const std::string &entity, FailureKind kind, int64_t latency_ms) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto &stat = stats_[make_key(source, entity)];
+    std::string sql;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto &stat = stats_[make_key(source, entity)];
+
+      switch (kind) {
+      case FailureKind::NETWORK:  ++stat.fail_network;  break;
+      case FailureKind::JSON:     ++stat.fail_json;     break;
+      case FailureKind::GRAPHQL:  ++stat.fail_graphql;  break;
+      case FailureKind::FORMAT:   ++stat.fail_format;   break;
+      default: assert(false && "Unknown FailureKind");
+      }
 
-    switch (kind) {
-    case FailureKind::NETWORK:  ++stat.fail_network;  break;
-    case FailureKind::JSON:     ++stat.fail_json;     break;
-    case FailureKind::GRAPHQL:  ++stat.fail_graphql;  break;
-    case FailureKind::FORMAT:   ++stat.fail_format;   break;
-    default: assert(false && "Unknown FailureKind");
+      sql = update_after_request(stat, latency_ms);
     }
-
-    update_after_request(stat, latency_ms);
+    persist(sql);
   }
 
   // indexer 维度失败计数(只有失败能归因)
   void record_indexer_fail(const std::string &source, const std::string &entity, const std::string &indexer) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    assert(!indexer.empty());
-    auto key = make_indexer_key(source, entity, indexer);
-    auto &st = indexer_fail_[key];
-    st.source = source;
-    st.entity = entity;
-    st.indexer = indexer;
-    if (!st.loaded && db_) {
-      load_indexer_fail_from_db_unsafe(st);
-      st.loaded = true;
+    std::string sql;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      assert(!indexer.empty());
+      auto key = make_indexer_key(source, entity, indexer);
+      auto &st = indexer_fail_[key];
+      st.source = source;
+      st.entity = entity;
+      st.indexer = indexer;
+      ++st.fail_requests;
+
+      auto now = std::chrono::steady_clock::now();
+      if (st.last_persist.time_since_epoch().count() == 0)
+        st.last_persist = now;
+      if ((now - st.last_persist) >= kPersistInterval) {
+        sql = indexer_fail_sql(st);
+        st.last_persist = now;
+      }
     }
-    ++st.fail_requests;
+    persist(sql);
+  }
 
-    auto now = std::chrono::steady_clock::now();
-    if (st.last_persist.time_since_epoch().count() == 0)
-      st.last_persist = now;
-    if ((now - st.last_persist) >= kPersistInterval) {
-      save_indexer_fail_to_db_unsafe(st);
-      st.last_persist = now;
+  // 连接池事件
+  void record_dns(bool cache_hit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++(cache_hit ? pool_.dns_cache_hits : pool_.dns_lookups);
+  }
+
+  void record_tls_handshake(bool resumed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pool_.tls_handshakes;
+    if (resumed)
+      ++pool_.tls_resumed;
+  }
+
+  void record_prewarmed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pool_.prewarmed;
+  }
+
+  void set_pool_window(double window, int inflight, int pending,
+                       double latency_ewma_ms, double latency_base_ms, int64_t decreases) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pool_.window = window;
+    pool_.inflight = inflight;
+    pool_.pending = pending;
+    pool_.latency_ewma_ms = latency_ewma_ms;
+    pool_.latency_base_ms = latency_base_ms;
+    pool_.window_decreases = decreases;
+  }
+
+  void record_hedge_sent() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pool_.hedges_sent;
+  }
+
+  void record_hedge_won() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pool_.hedges_won;
+  }
+
+  void record_hedge_denied() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pool_.hedges_denied;
+  }
+
+  void set_api_key(size_t index, ApiKeyStat stat) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pool_.keys.size() <= index)
+      pool_.keys.resize(index + 1);
+    pool_.keys[index] = std::move(stat);
+  }
+
+  // 最近请求延时的 p95(样本不足返回 0), 用作对冲触发点
+  int64_t get_latency_p95(const std::string &source, const std::string &entity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stats_.find(make_key(source, entity));
+    if (it == stats_.end() || it->second.recent_latencies.size() < kRecentLatencies / 2)
+      return 0;
+    std::vector<int64_t> v(it->second.recent_latencies.begin(), it->second.recent_latencies.end());
+    size_t k = (v.size() * 95 + 99) / 100 - 1;
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+  }
+
+  // 写库线程事件
+  void set_writer_queue(size_t depth) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_.queue_depth = static_cast<int64_t>(depth);
+    writer_.max_queue_depth = std::max(writer_.max_queue_depth, writer_.queue_depth);
+  }
+
+  void record_writer_stall() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++writer_.stalls;
+  }
+
+  void record_writer_failure(int64_t pages) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_.failed_pages += pages;
+  }
+
+  void record_writer_commit(int64_t pages, int64_t rows, int64_t ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++writer_.commits;
+    writer_.pages += pages;
+    writer_.last_group = pages;
+    writer_.max_group = std::max(writer_.max_group, pages);
+    ++writer_.group_hist[pages >= 8 ? 3 : pages >= 4 ? 2 : pages >= 2 ? 1 : 0];
+    writer_.rows += rows;
+    writer_.commit_ms += ms;
+  }
+
+  std::string get_writer_dump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return json{
+        {"queue_depth", writer_.queue_depth},
+        {"max_queue_depth", writer_.max_queue_depth},
+        {"stalls", writer_.stalls},
+        {"commits", writer_.commits},
+        {"pages", writer_.pages},
+        {"avg_group", writer_.commits ? static_cast<double>(writer_.pages) / writer_.commits : 0.0},
+        {"last_group", writer_.last_group},
+        {"max_group", writer_.max_group},
+        {"group_hist", {{"1", writer_.group_hist[0]}, {"2-3", writer_.group_hist[1]},
+                        {"4-7", writer_.group_hist[2]}, {"8+", writer_.group_hist[3]}}},
+        {"rows", writer_.rows},
+        {"commit_ms", writer_.commit_ms},
+        {"failed_pages", writer_.failed_pages},
+    }.dump();
+  }
+
+  void set_memory(const MemoryStat &m) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_ = m;
+  }
+
+  std::string get_memory_dump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return json{
+        {"limit", memory_.limit},
+        {"used", memory_.used},
+        {"peak", memory_.peak},
+        {"stalls", memory_.stalls},
+        {"waiting", memory_.waiting},
+    }.dump();
+  }
+
+  std::string get_pool_dump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json keys = json::array();
+    for (const auto &k : pool_.keys) {
+      keys.push_back({
+          {"key", k.label},
+          {"rate_per_sec", k.rate_per_sec},
+          {"tokens", k.tokens},
+          {"inflight", k.inflight},
+          {"max_inflight", k.max_inflight},
+          {"error_rate", k.error_rate},
+          {"requests", k.requests},
+          {"errors", k.errors},
+          {"throttled", k.throttled},
+          {"cooling", k.cooling},
+      });
     }
+    return json{
+        {"dns_lookups", pool_.dns_lookups},
+        {"dns_cache_hits", pool_.dns_cache_hits},
+        {"tls_handshakes", pool_.tls_handshakes},
+        {"tls_resumed", pool_.tls_resumed},
+        {"prewarmed", pool_.prewarmed},
+        {"window", pool_.window},
+        {"inflight", pool_.inflight},
+        {"pending", pool_.pending},
+        {"latency_ewma_ms", pool_.latency_ewma_ms},
+        {"latency_base_ms", pool_.latency_base_ms},
+        {"window_decreases", pool_.window_decreases},
+        {"hedges_sent", pool_.hedges_sent},
+        {"hedges_won", pool_.hedges_won},
+        {"hedges_denied", pool_.hedges_denied},
+        {"keys", keys},
+    }.dump();
   }
 
   // 获取所有统计(JSON dump 字符串；用于 HTTP 直接返回，避免重复序列化)
@@ -220,22 +525,24 @@ private:
   }
 
   // 请求后公共更新：累计、延时、成功率、节流落盘
-  void update_after_request(EntityStat &stat, int64_t latency_ms) {
+  // 返回到期的落盘 SQL(未到期为空), 由调用方解锁后 persist
+  std::string update_after_request(EntityStat &stat, int64_t latency_ms) {
     stat.total_requests++;
     stat.total_api_time_ms += latency_ms;
     stat.last_update = std::chrono::steady_clock::now();
 
     stat.recent_latencies.push_back(latency_ms);
-    if (stat.recent_latencies.size() > 20)
+    if (stat.recent_latencies.size() > kRecentLatencies)
       stat.recent_latencies.pop_front();
 
     stat.success_rate = static_cast<double>(stat.success_requests) / stat.total_requests * 100.0;
 
     auto now = std::chrono::steady_clock::now();
     if ((now - stat.last_persist) >= kPersistInterval) {
-      save_to_db(stat);
       stat.last_persist = now;
+      return persist_sql(stat);
     }
+    return {};
   }
 
   struct IndexerFailStat {
@@ -243,7 +550,6 @@ private:
     std::string entity;
     std::string indexer;
     int64_t fail_requests = 0;
-    bool loaded = false;
     std::chrono::steady_clock::time_point last_persist{};
   };
 
@@ -251,8 +557,8 @@ private:
     return source + "/" + entity + "/" + indexer;
   }
 
-  void load_indexer_fail_from_db_unsafe(IndexerFailStat &st);
-  void save_indexer_fail_to_db_unsafe(const IndexerFailStat &st);
+  void load_indexer_fails_from_db(const std::string &source, const std::string &entity);
+  std::string indexer_fail_sql(const IndexerFailStat &st) const;
 
   void rebuild_cache_if_needed_unsafe() {
     auto now = std::chrono::steady_clock::now();
@@ -306,6 +612,11 @@ private:
           {"sync_done", stat.sync_done},
           {"total_rows_synced", stat.total_rows_synced},
           {"api_state", api_state_str},
+          {"page_size", stat.page_size},
+          {"bytes_compressed", stat.bytes_compressed},
+          {"bytes_uncompressed", stat.bytes_uncompressed},
+          {"backfill_shards", stat.backfill_shards},
+          {"refresh_shards", stat.refresh_shards},
       };
     }
 
@@ -316,13 +627,18 @@ private:
   // 从数据库加载历史统计
   void load_from_db(EntityStat &stat);
 
-  // 保存统计到数据库
-  void save_to_db(const EntityStat &stat);
+  // 统计落盘: 锁内拼 SQL, 锁外交 persister_(写库线程), io 线程不碰库
+  std::string persist_sql(const EntityStat &stat) const;
+  void persist(const std::string &sql);
 
   std::mutex mutex_;
   std::unordered_map<std::string, EntityStat> stats_;
   std::unordered_map<std::string, IndexerFailStat> indexer_fail_;
+  PoolStat pool_;
+  WriterStat writer_;
+  MemoryStat memory_;
   Database *db_ = nullptr;
+  PersistFunc persister_;
 
   // 缓存(避免频繁构建/序列化)
   static constexpr auto kCacheTtl = std::chrono::milliseconds(200);
@@ -331,6 +647,7 @@ private:
 
   // meta 落盘节流
   static constexpr auto kPersistInterval = std::chrono::seconds(5);
+  static constexpr size_t kRecentLatencies = 20;
 };
 
 // ============================================================================
@@ -366,11 +683,11 @@ inline void StatsManager::load_from_db(EntityStat &stat) {
   }
 }
 
-inline void StatsManager::save_to_db(const EntityStat &stat) {
+inline std::string StatsManager::persist_sql(const EntityStat &stat) const {
   if (!db_)
-    return;
+    return {};
 
-  std::string sql =
+  return
       "INSERT OR REPLACE INTO entity_stats_meta "
       "(source, entity, total_requests, success_requests, fail_network, fail_json, fail_graphql, fail_format, total_rows_synced, total_api_time_ms, success_rate, updated_at) "
       "VALUES (" +
@@ -385,25 +702,43 @@ inline void StatsManager::save_to_db(const EntityStat &stat) {
       std::to_string(stat.total_rows_synced) + ", " +
       std::to_string(stat.total_api_time_ms) + ", " +
       std::to_string(stat.success_rate) + ", CURRENT_TIMESTAMP)";
-  db_->execute(sql);
 }
 
-inline void StatsManager::load_indexer_fail_from_db_unsafe(StatsManager::IndexerFailStat &st) {
-  assert(db_);
-  std::string sql =
-      "SELECT fail_requests FROM indexer_fail_meta WHERE source = " +
-      entities::escape_sql(st.source) +
-      " AND entity = " + entities::escape_sql(st.entity) +
-      " AND indexer = " + entities::escape_sql(st.indexer);
-  auto result = db_->query_json(sql);
-  if (!result.empty() && result[0].contains("fail_requests")) {
-    st.fail_requests = result[0]["fail_requests"].get<int64_t>();
+inline void StatsManager::persist(const std::string &sql) {
+  if (!db_ || sql.empty())
+    return;
+  PersistFunc persister;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    persister = persister_;
   }
+  if (persister)
+    persister(sql);
+  else
+    db_->execute(sql);
 }
 
-inline void StatsManager::save_indexer_fail_to_db_unsafe(const StatsManager::IndexerFailStat &st) {
-  assert(db_);
+inline void StatsManager::load_indexer_fails_from_db(const std::string &source, const std::string &entity) {
+  if (!db_)
+    return;
   std::string sql =
+      "SELECT indexer, fail_requests FROM indexer_fail_meta WHERE source = " +
+      entities::escape_sql(source) +
+      " AND entity = " + entities::escape_sql(entity);
+  for (const auto &row : db_->query_json(sql)) {
+    auto indexer = row["indexer"].get<std::string>();
+    auto &st = indexer_fail_[make_indexer_key(source, entity, indexer)];
+    st.source = source;
+    st.entity = entity;
+    st.indexer = indexer;
+    st.fail_requests = row["fail_requests"].get<int64_t>();
+  }
+}
+
+inline std::string StatsManager::indexer_fail_sql(const StatsManager::IndexerFailStat &st) const {
+  if (!db_)
+    return {};
+  return
       "INSERT OR REPLACE INTO indexer_fail_meta "
       "(source, entity, indexer, fail_requests, updated_at) "
       "VALUES (" +
@@ -411,5 +746,4 @@ inline void StatsManager::save_indexer_fail_to_db_unsafe(const StatsManager::Ind
       entities::escape_sql(st.entity) + ", " +
       entities::escape_sql(st.indexer) + ", " +
       std::to_string(st.fail_requests) + ", CURRENT_TIMESTAMP)";
-  db_->execute(sql);
 }
@@ -0,0 +1,461 @@
+#pragma once
+
+// ============================================================================
+// PageArchive - 原始响应归档(可选) + 离线重灌
+//   拉取成功的每个响应 body 压缩后追加到段文件, 连同各页的 entity / 游标与分片游标变更,
+//   重灌时按写入顺序回放进新库: 只读本地文件, 无网络、无限速
+//
+//   段文件: <archive_dir>/<启动 unix 秒>-<序号>.pga, 只追加, 超过 PAGE_ARCHIVE_SEGMENT_BYTES 换新段
+//   记录: "PGA1" | type u8 | meta_len u32 | plain_len u32 | body_len u32 | meta(JSON) | body(raw deflate)
+//     BODY    {"s":source,"t":[[alias,table],...]} + 响应 body (单独请求 alias = plural, 合批为 e0/e1/...)
+//             扇出页的第 2 片起带 "cont":true: 行接到上一条 BODY 之后(按 id 去重), 由其后的 PAGE 一并落盘
+//     PAGE    {"s":source,"table":table,"key":cursor_key,"c":[value,skip,id]}  紧跟其 BODY, 本页行 + 推进后的游标
+//             (全量重拉分片写暂存表, key 为空: 重灌只 upsert 行)
+//     CURSORS {"s":source,"put":[[key,value,skip,id],...],"del":[key,...]}   回填分片规划/完成
+//   io 线程只做序列化入队, 压缩与写盘在归档线程
+//   排队中的记录(响应 body 副本)计入 MemoryBudget: 写盘跟不上时占满预算, 执行器随之暂停发请求;
+//   写盘后的释放经 io_context 回到 io 线程(预算等待者在释放方线程续发)
+// ============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/beast/zlib.hpp>
+#include <nlohmann/json.hpp>
+
+#include "../core/column_batch.hpp"
+#include "../core/database.hpp"
+#include "../core/entity_definition.hpp"
+#include "../core/memory_budget.hpp"
+#include "page_decoder.hpp"
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define PAGE_ARCHIVE_SEGMENT_BYTES (256LL << 20) // 单段上限(压缩后)
+#define PAGE_ARCHIVE_LEVEL 1                     // deflate 级别: 偏速度
+#define REINGEST_GROUP_ROWS 100000               // 重灌: 单事务行数
+
+namespace page_archive {
+
+namespace fs = std::filesystem;
+namespace asio = boost::asio;
+namespace zlib = boost::beast::zlib;
+using json = nlohmann::json;
+
+enum class RecordType : uint8_t { BODY = 1, PAGE = 2, CURSORS = 3 };
+
+inline constexpr char kMagic[4] = {'P', 'G', 'A', '1'};
+inline constexpr size_t kHeaderBytes = 4 + 1 + 4 * 3;
+
+inline json cursor_json(const SyncCursor &c) { return json::array({c.value, c.skip, c.id}); }
+
+inline SyncCursor cursor_from_json(const json &j) {
+  return {j.at(0).get<std::string>(), j.at(1).get<int>(), j.at(2).get<std::string>()};
+}
+
+inline void put_u32(std::string &out, uint32_t v) {
+  char b[4];
+  std::memcpy(b, &v, 4);
+  out.append(b, 4);
+}
+
+inline uint32_t get_u32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+// ============================================================================
+// 写端
+// ============================================================================
+class Writer {
+public:
+  Writer(std::string dir, asio::io_context &ioc) : dir_(std::move(dir)), ioc_(ioc), started_(std::time(nullptr)) {
+    fs::create_directories(dir_);
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join(); // 已入队的记录写完再退出
+    if (file_)
+      std::fclose(file_);
+  }
+
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  // 以下均在 io 线程调用, 记录顺序即回放顺序
+  // targets: (alias, table)
+  // continued: 扇出页的后续片, 与上一条 BODY 同属一页
+  void write_body(const std::string &source, const std::vector<std::pair<std::string, std::string>> &targets,
+                  std::string body, bool continued = false) {
+    json t = json::array();
+    for (const auto &[alias, table] : targets)
+      t.push_back({alias, table});
+    json meta{{"s", source}, {"t", std::move(t)}};
+    if (continued)
+      meta["cont"] = true;
+    push(RecordType::BODY, std::move(meta), std::move(body));
+  }
+
+  void write_page(const std::string &source, const std::string &table, const std::string &cursor_key,
+                  const SyncCursor &cursor) {
+    push(RecordType::PAGE, json{{"s", source}, {"table", table}, {"key", cursor_key}, {"c", cursor_json(cursor)}});
+  }
+
+  void write_cursors(const std::string &source, const std::vector<std::pair<std::string, SyncCursor>> &puts,
+                     const std::vector<std::string> &dels = {}) {
+    json p = json::array();
+    for (const auto &[key, c] : puts)
+      p.push_back({key, c.value, c.skip, c.id});
+    push(RecordType::CURSORS, json{{"s", source}, {"put", std::move(p)}, {"del", dels}});
+  }
+
+private:
+  struct Record {
+    RecordType type;
+    std::string meta;
+    std::string body;
+    size_t bytes() const { return meta.size() + body.size(); }
+  };
+
+  void push(RecordType type, const json &meta, std::string body = {}) {
+    Record rec{type, meta.dump(), std::move(body)};
+    MemoryBudget::instance().acquire(rec.bytes());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(rec));
+    }
+    cv_.notify_one();
+  }
+
+  void run() {
+    std::string out;
+    for (;;) {
+      std::deque<Record> batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty())
+          return;
+        batch.swap(queue_);
+      }
+      size_t bytes = 0;
+      for (auto &rec : batch) {
+        out.clear();
+        encode(rec, out);
+        write(out);
+        bytes += rec.bytes();
+      }
+      std::fflush(file_);
+      asio::post(ioc_, [bytes]() { MemoryBudget::instance().release(bytes); });
+    }
+  }
+
+  void encode(const Record &rec, std::string &out) {
+    std::string body;
+    if (!rec.body.empty())
+      compress(rec.body, body);
+    out.append(kMagic, 4);
+    out += static_cast<char>(rec.type);
+    put_u32(out, static_cast<uint32_t>(rec.meta.size()));
+    put_u32(out, static_cast<uint32_t>(rec.body.size()));
+    put_u32(out, static_cast<uint32_t>(body.size()));
+    out += rec.meta;
+    out += body;
+  }
+
+  void compress(const std::string &in, std::string &out) {
+    deflater_.reset(PAGE_ARCHIVE_LEVEL, 15, 8, zlib::Strategy::normal);
+    out.resize(deflater_.upper_bound(in.size()));
+    zlib::z_params zs;
+    zs.next_in = in.data();
+    zs.avail_in = in.size();
+    zs.next_out = out.data();
+    zs.avail_out = out.size();
+    boost::system::error_code ec;
+    deflater_.write(zs, zlib::Flush::finish, ec);
+    assert((!ec || ec == zlib::error::end_of_stream) && "archive deflate failed");
+    out.resize(zs.total_out);
+  }
+
+  void write(const std::string &rec) {
+    if (!file_ || segment_bytes_ + static_cast<int64_t>(rec.size()) > PAGE_ARCHIVE_SEGMENT_BYTES)
+      open_segment();
+    size_t n = std::fwrite(rec.data(), 1, rec.size(), file_);
+    assert(n == rec.size() && "archive write failed");
+    segment_bytes_ += static_cast<int64_t>(n);
+  }
+
+  void open_segment() {
+    if (file_)
+      std::fclose(file_);
+    char name[64];
+    std::snprintf(name, sizeof(name), "%010lld-%06d.pga", static_cast<long long>(started_), seq_++);
+    auto path = fs::path(dir_) / name;
+    file_ = std::fopen(path.string().c_str(), "ab");
+    assert(file_ && "cannot open archive segment");
+    segment_bytes_ = 0;
+    std::cout << "[Archive] segment " << path.string() << std::endl;
+  }
+
+  std::string dir_;
+  asio::io_context &ioc_;
+  std::time_t started_;
+
+  // 归档线程
+  zlib::deflate_stream deflater_;
+  std::FILE *file_ = nullptr;
+  int64_t segment_bytes_ = 0;
+  int seq_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Record> queue_;
+  bool stop_ = false;
+  std::thread thread_; // 构造函数体内启动: 依赖以上成员
+};
+
+// ============================================================================
+// 离线重灌: 段文件按名字顺序回放进 db (建议新库), 行一律 upsert, 游标随页推进
+// ============================================================================
+struct ReingestStats {
+  int64_t segments = 0;
+  int64_t bodies = 0;
+  int64_t pages = 0;
+  int64_t rows = 0;
+  int64_t bad_bodies = 0;
+  std::string error; // 非空 = 写库失败, 重灌在此中止(之前的页与游标已落盘)
+};
+
+class Reingester {
+public:
+  explicit Reingester(Database &db) : db_(db) { db_.init_sync_state(); }
+
+  ReingestStats run(const std::string &dir) {
+    std::vector<fs::path> segments;
+    for (const auto &entry : fs::directory_iterator(dir)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".pga")
+        segments.push_back(entry.path());
+    }
+    std::sort(segments.begin(), segments.end());
+
+    for (const auto &path : segments) {
+      if (!stats_.error.empty())
+        break;
+      replay_segment(path);
+      ++stats_.segments;
+    }
+    flush();
+    return stats_;
+  }
+
+private:
+  struct Target {
+    std::string alias;
+    std::string table;
+    ColumnBatch rows;
+  };
+
+  void replay_segment(const fs::path &path) {
+    std::FILE *f = std::fopen(path.string().c_str(), "rb");
+    assert(f && "cannot open archive segment");
+    std::cout << "[Reingest] " << path.string() << std::endl;
+
+    char header[kHeaderBytes];
+    std::string meta, body;
+    while (stats_.error.empty() && std::fread(header, 1, kHeaderBytes, f) == kHeaderBytes) {
+      if (std::memcmp(header, kMagic, 4) != 0) {
+        std::cerr << "[Reingest] bad record magic, skip rest of " << path.string() << std::endl;
+        break;
+      }
+      auto type = static_cast<RecordType>(header[4]);
+      uint32_t meta_len = get_u32(header + 5);
+      uint32_t plain_len = get_u32(header + 9);
+      uint32_t body_len = get_u32(header + 13);
+      meta.resize(meta_len);
+      body.resize(body_len);
+      if (std::fread(meta.data(), 1, meta_len, f) != meta_len ||
+          std::fread(body.data(), 1, body_len, f) != body_len) {
+        std::cerr << "[Reingest] truncated record at end of " << path.string() << std::endl; // 崩溃时的半条
+        break;
+      }
+      json m = json::parse(meta);
+      switch (type) {
+      case RecordType::BODY:
+        on_body(m, body, plain_len);
+        break;
+      case RecordType::PAGE:
+        on_page(m);
+        break;
+      case RecordType::CURSORS:
+        on_cursors(m);
+        break;
+      }
+    }
+    std::fclose(f);
+  }
+
+  // "cont" BODY(扇出页的后续片)把行接到当前 targets_ 之后; 同页任一片坏掉则整页作废
+  void on_body(const json &m, const std::string &body, uint32_t plain_len) {
+    ++stats_.bodies;
+    bool continued = m.value("cont", false);
+    if (continued && body_bad_)
+      return;
+    body_bad_ = false;
+    source_ = m["s"].get<std::string>();
+    std::vector<Target> parts;
+    for (const auto &t : m["t"]) {
+      const auto *e = entities::find_entity_by_table(t[1].get<std::string>().c_str());
+      assert(e && "archive references unknown table");
+      if (inited_.insert(e->table).second)
+        db_.init_entity(e);
+      parts.push_back({t[0].get<std::string>(), e->table, ColumnBatch(e)});
+    }
+
+    std::string plain;
+    bool ok = inflate(body, plain_len, plain);
+    if (ok) {
+      decoder_.reset();
+      for (auto &t : parts)
+        decoder_.add_target(t.alias, &t.rows);
+      decoder_.feed(plain.data(), plain.size());
+      ok = decoder_.finish() == graphql::PageStatus::OK;
+    }
+    if (!ok) {
+      ++stats_.bad_bodies;
+      body_bad_ = true;
+      targets_.clear();
+      return;
+    }
+
+    if (!continued) {
+      targets_ = std::move(parts);
+      return;
+    }
+    for (auto &part : parts) {
+      auto it = std::find_if(targets_.begin(), targets_.end(),
+                             [&](const Target &t) { return t.alias == part.alias && t.table == part.table; });
+      if (it == targets_.end())
+        targets_.push_back(std::move(part));
+      else
+        append_distinct(it->rows, part.rows);
+    }
+  }
+
+  // 扇出片间可能重叠: 已有的 id 不再追加(同一 upsert 语句不能有重复键)
+  static void append_distinct(ColumnBatch &dst, const ColumnBatch &src) {
+    int id_col = entities::find_column(dst.entity(), "id");
+    std::unordered_set<std::string> seen;
+    for (size_t r = 0; r < dst.size(); ++r)
+      seen.insert(dst.cell_string(id_col, r));
+    size_t base = dst.size();
+    dst.append(src);
+    std::vector<uint8_t> keep(dst.size(), 1);
+    bool dropped = false;
+    for (size_t r = base; r < dst.size(); ++r) {
+      if (!seen.insert(dst.cell_string(id_col, r)).second) {
+        keep[r] = 0;
+        dropped = true;
+      }
+    }
+    if (dropped)
+      dst.retain(keep);
+  }
+
+  // 本页行取自紧邻的 BODY 中同表的 target
+  void on_page(const json &m) {
+    auto table = m["table"].get<std::string>();
+    auto it = std::find_if(targets_.begin(), targets_.end(), [&](const Target &t) { return t.table == table; });
+    if (it == targets_.end() || m["s"].get<std::string>() != source_)
+      return; // BODY 解码失败或缺失
+    const auto *e = it->rows.entity();
+    ++stats_.pages;
+    stats_.rows += static_cast<int64_t>(it->rows.size());
+    group_rows_ += it->rows.size();
+    group_.push_back(std::make_unique<PageWrite>(PageWrite{
+        e->table, e->columns, std::move(it->rows), source_, m["key"].get<std::string>(), cursor_from_json(m["c"])}));
+    it->rows = ColumnBatch(e);
+    if (group_rows_ >= REINGEST_GROUP_ROWS)
+      flush();
+  }
+
+  // 游标变更须在之前的页落盘后生效
+  void on_cursors(const json &m) {
+    flush();
+    if (!stats_.error.empty())
+      return;
+    auto source = m["s"].get<std::string>();
+    std::vector<std::pair<std::string, SyncCursor>> puts;
+    for (const auto &p : m["put"])
+      puts.push_back({p[0].get<std::string>(), SyncCursor{p[1].get<std::string>(), p[2].get<int>(), p[3].get<std::string>()}});
+    if (!puts.empty())
+      db_.put_cursors(source, puts);
+    for (const auto &key : m["del"])
+      db_.delete_cursor(source, key.get<std::string>());
+  }
+
+  void flush() {
+    if (group_.empty() || !stats_.error.empty())
+      return;
+    std::vector<const PageWrite *> pages;
+    for (const auto &p : group_)
+      pages.push_back(p.get());
+    if (!db_.atomic_insert_pages(pages, stats_.error))
+      std::cerr << "[Reingest] write failed, stopping: " << stats_.error << std::endl;
+    group_.clear();
+    group_rows_ = 0;
+  }
+
+  bool inflate(const std::string &in, uint32_t plain_len, std::string &out) {
+    out.resize(plain_len);
+    if (plain_len == 0)
+      return true;
+    inflater_.reset();
+    zlib::z_params zs;
+    zs.next_in = in.data();
+    zs.avail_in = in.size();
+    zs.next_out = out.data();
+    zs.avail_out = out.size();
+    boost::system::error_code ec;
+    inflater_.write(zs, zlib::Flush::finish, ec);
+    return (!ec || ec == zlib::error::end_of_stream) && zs.total_out == plain_len;
+  }
+
+  Database &db_;
+  ReingestStats stats_;
+  std::unordered_set<std::string> inited_;
+  zlib::inflate_stream inflater_;
+  graphql::PageDecoder decoder_;
+  std::string source_;
+  std::vector<Target> targets_; // 最近一个 BODY(含其 "cont" 续片)的解码结果
+  bool body_bad_ = false;       // 当前页已有片解码失败, 其续片一并丢弃
+  std::vector<std::unique_ptr<PageWrite>> group_;
+  size_t group_rows_ = 0;
+};
+
+} // namespace page_archive
+
+using PageArchive = page_archive::Writer;
@@ -0,0 +1,130 @@
+#pragma once
+
+// ============================================================================
+// PageBatcher - 同一 subgraph 的多 entity 分页合批(GraphQL 别名)
+//   同一事件循环 tick 内提交的页请求合成一个文档 {e0:splits(...){..} e1:merges(...){..}},
+//   响应按别名解码到各自的 ColumnBatch, 再逐个回调执行器推进游标
+//   任一别名出错(errors/截断)整批失败, 各执行器按原逻辑重试
+//   归档开启时整批 body 写一条 BODY 记录, 各执行器随后写各自的 PAGE 记录
+// ============================================================================
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../core/column_batch.hpp"
+#include "../infra/https_pool.hpp"
+#include "page_archive.hpp"
+#include "page_decoder.hpp"
+
+class PageBatcher {
+public:
+  // 单个执行器的本页结果; bytes 按行数比例分摊(整批无行时均分)
+  struct Result {
+    bool success;
+    graphql::PageStatus status;
+    size_t rows;
+    size_t start_row;
+    TransferBytes bytes;
+    const std::vector<std::string> &error_messages;
+  };
+  using Callback = std::function<void(const Result &)>;
+
+  PageBatcher(HttpsPool &pool, std::string target, std::string source = {}, PageArchive *archive = nullptr)
+      : pool_(pool), target_(std::move(target)), source_(std::move(source)), archive_(archive) {}
+
+  PageBatcher(const PageBatcher &) = delete;
+  PageBatcher &operator=(const PageBatcher &) = delete;
+
+  // selection: "plural(args){fields}", 解码到 out 末尾
+  void submit(std::string selection, ColumnBatch *out, Callback cb) {
+    queued_.push_back({std::move(selection), out, std::move(cb)});
+    if (flush_posted_)
+      return;
+    flush_posted_ = true;
+    pool_.post([this]() { flush(); });
+  }
+
+private:
+  struct Member {
+    std::string selection;
+    ColumnBatch *out;
+    Callback cb;
+  };
+
+  struct Batch {
+    std::vector<Member> members;
+    graphql::PageDecoder decoder;
+    std::string body; // 归档用
+  };
+
+  void flush() {
+    flush_posted_ = false;
+    auto batch = std::make_shared<Batch>();
+    batch->members = std::move(queued_);
+    queued_.clear();
+
+    std::string query = R"({"query":"{)";
+    batch->decoder.reset();
+    for (size_t i = 0; i < batch->members.size(); ++i) {
+      std::string alias = "e" + std::to_string(i);
+      query += (i ? " " : "") + alias + ":" + batch->members[i].selection;
+      batch->decoder.add_target(alias, batch->members[i].out);
+    }
+    query += R"(}"})";
+
+    auto *archive = archive_;
+    pool_.async_post_stream(
+        target_, query,
+        [batch, archive](const char *data, size_t n) {
+          if (archive)
+            batch->body.append(data, n);
+          batch->decoder.feed(data, n);
+        },
+        [batch, archive, source = source_](bool success, const TransferBytes &bytes) {
+          dispatch(*batch, success, bytes, archive, source);
+        });
+  }
+
+  // 回调中执行器会提交下一页(进入新一批), 本批状态由 shared_ptr 持有, 不再访问 this
+  static void dispatch(Batch &batch, bool success, const TransferBytes &bytes, PageArchive *archive,
+                       const std::string &source) {
+    auto status = success ? batch.decoder.finish() : graphql::PageStatus::OK;
+    if (!success)
+      batch.decoder.abort();
+    if (archive && success && status == graphql::PageStatus::OK) {
+      std::vector<std::pair<std::string, std::string>> targets;
+      for (size_t i = 0; i < batch.members.size(); ++i)
+        targets.push_back({"e" + std::to_string(i), batch.members[i].out->entity()->table});
+      archive->write_body(source, targets, std::move(batch.body));
+    }
+
+    size_t n = batch.members.size();
+    size_t total_rows = 0;
+    for (size_t i = 0; i < n; ++i)
+      total_rows += batch.decoder.rows(i);
+
+    for (size_t i = 0; i < n; ++i) {
+      size_t rows = batch.decoder.rows(i);
+      TransferBytes share;
+      if (total_rows > 0) {
+        share.wire = bytes.wire * rows / total_rows;
+        share.plain = bytes.plain * rows / total_rows;
+      } else {
+        share.wire = bytes.wire / n;
+        share.plain = bytes.plain / n;
+      }
+      batch.members[i].cb(Result{success, status, rows, batch.decoder.start_row(i), share,
+                                 batch.decoder.error_messages()});
+    }
+  }
+
+  HttpsPool &pool_;
+  std::string target_;
+  std::string source_;
+  PageArchive *archive_;
+  std::vector<Member> queued_;
+  bool flush_posted_ = false;
+};
@@ -0,0 +1,719 @@
+#pragma once
+
+// ============================================================================
+// GraphQL 页面流式解码器
+// 响应字节(可任意切分) → SAX 事件 → 各 entity 的 ColumnBatch, 不建 JSON DOM
+//   {"data":{"<key>":[{field: value | {id} | [...]}, ...]}, "errors":[...]}
+// ============================================================================
+
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/column_batch.hpp"
+#include "../core/entity_definition.hpp"
+
+namespace graphql {
+
+// ============================================================================
+// JsonPushParser - 可续接的增量 JSON 解析器
+// Handler 需实现: on_key / on_string / on_number / on_literal /
+//                 on_begin_object / on_end_object / on_begin_array / on_end_array
+// ============================================================================
+enum class Literal : uint8_t { IS_NULL, IS_TRUE, IS_FALSE };
+
+class JsonPushParser {
+public:
+  void reset() {
+    state_ = State::VALUE;
+    stack_.clear();
+    buf_.clear();
+    failed_ = false;
+    string_is_key_ = false;
+    unicode_digits_ = 0;
+    unicode_code_ = 0;
+    high_surrogate_ = 0;
+  }
+
+  bool failed() const { return failed_; }
+  bool complete() const { return !failed_ && state_ == State::DONE; }
+
+  template <typename Handler>
+  void feed(Handler &h, const char *data, size_t n) {
+    size_t i = 0;
+    while (i < n && !failed_) {
+      char c = data[i];
+      switch (state_) {
+      case State::VALUE:
+        if (is_ws(c)) {
+          ++i;
+          break;
+        }
+        begin_value(h, c);
+        ++i;
+        break;
+
+      case State::VALUE_OR_END:
+        if (is_ws(c)) {
+          ++i;
+          break;
+        }
+        if (c == ']') {
+          stack_.pop_back();
+          h.on_end_array();
+          after_value();
+        } else {
+          begin_value(h, c);
+        }
+        ++i;
+        break;
+
+      case State::KEY_OR_END:
+      case State::KEY:
+        if (is_ws(c)) {
+          ++i;
+          break;
+        }
+        if (c == '}' && state_ == State::KEY_OR_END) {
+          stack_.pop_back();
+          h.on_end_object();
+          after_value();
+        } else if (c == '"') {
+          begin_string(true);
+        } else {
+          failed_ = true;
+        }
+        ++i;
+        break;
+
+      case State::COLON:
+        if (is_ws(c)) {
+          ++i;
+          break;
+        }
+        if (c != ':') {
+          failed_ = true;
+          break;
+        }
+        state_ = State::VALUE;
+        ++i;
+        break;
+
+      case State::AFTER_VALUE:
+        if (is_ws(c)) {
+          ++i;
+          break;
+        }
+        if (c == ',') {
+          state_ = (stack_.back() == '{') ? State::KEY : State::VALUE;
+        } else if (c == '}' && stack_.back() == '{') {
+          stack_.pop_back();
+          h.on_end_object();
+          after_value();
+        } else if (c == ']' && stack_.back() == '[') {
+          stack_.pop_back();
+          h.on_end_array();
+          after_value();
+        } else {
+          failed_ = true;
+        }
+        ++i;
+        break;
+
+      case State::STRING: {
+        // 快路径: 整段拷贝到下一个 '"' 或 '\\'
+        size_t j = i;
+        while (j < n && data[j] != '"' && data[j] != '\\')
+          ++j;
+        buf_.append(data + i, j - i);
+        i = j;
+        if (i == n)
+          break;
+        if (data[i] == '\\') {
+          state_ = State::ESCAPE;
+        } else {
+          end_string(h);
+        }
+        ++i;
+        break;
+      }
+
+      case State::ESCAPE:
+        switch (c) {
+        case '"': buf_ += '"'; break;
+        case '\\': buf_ += '\\'; break;
+        case '/': buf_ += '/'; break;
+        case 'b': buf_ += '\b'; break;
+        case 'f': buf_ += '\f'; break;
+        case 'n': buf_ += '\n'; break;
+        case 'r': buf_ += '\r'; break;
+        case 't': buf_ += '\t'; break;
+        case 'u':
+          unicode_digits_ = 0;
+          unicode_code_ = 0;
+          state_ = State::UNICODE;
+          ++i;
+          continue;
+        default:
+          failed_ = true;
+          continue;
+        }
+        state_ = State::STRING;
+        ++i;
+        break;
+
+      case State::UNICODE: {
+        int v = hex_value(c);
+        if (v < 0) {
+          failed_ = true;
+          break;
+        }
+        unicode_code_ = (unicode_code_ << 4) | static_cast<uint32_t>(v);
+        ++i;
+        if (++unicode_digits_ == 4) {
+          append_code_point(unicode_code_);
+          state_ = State::STRING;
+        }
+        break;
+      }
+
+      case State::NUMBER:
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+          buf_ += c;
+          ++i;
+          break;
+        }
+        h.on_number(std::string_view(buf_));
+        after_value();
+        break; // 当前字符重新处理
+
+      case State::LITERAL:
+        if (c >= 'a' && c <= 'z') {
+          buf_ += c;
+          ++i;
+          break;
+        }
+        end_literal(h);
+        break; // 当前字符重新处理
+
+      case State::DONE:
+        if (!is_ws(c))
+          failed_ = true;
+        ++i;
+        break;
+      }
+    }
+  }
+
+  // 输入结束: 顶层为裸数字/字面量时在此收尾
+  template <typename Handler>
+  void finish(Handler &h) {
+    if (failed_ || !stack_.empty())
+      return;
+    if (state_ == State::NUMBER) {
+      h.on_number(std::string_view(buf_));
+      after_value();
+    } else if (state_ == State::LITERAL) {
+      end_literal(h);
+    }
+  }
+
+private:
+  enum class State : uint8_t {
+    VALUE,        // 期待值
+    VALUE_OR_END, // '[' 之后: 值或 ']'
+    KEY_OR_END,   // '{' 之后: key 或 '}'
+    KEY,          // ',' 之后: key
+    COLON,
+    AFTER_VALUE, // 期待 ',' 或闭合
+    STRING,
+    ESCAPE,
+    UNICODE,
+    NUMBER,
+    LITERAL,
+    DONE,
+  };
+
+  static bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+  static int hex_value(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  template <typename Handler>
+  void begin_value(Handler &h, char c) {
+    if (c == '{') {
+      stack_.push_back('{');
+      h.on_begin_object();
+      state_ = State::KEY_OR_END;
+    } else if (c == '[') {
+      stack_.push_back('[');
+      h.on_begin_array();
+      state_ = State::VALUE_OR_END;
+    } else if (c == '"') {
+      begin_string(false);
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+      buf_.assign(1, c);
+      state_ = State::NUMBER;
+    } else if (c == 't' || c == 'f' || c == 'n') {
+      buf_.assign(1, c);
+      state_ = State::LITERAL;
+    } else {
+      failed_ = true;
+    }
+  }
+
+  void begin_string(bool is_key) {
+    buf_.clear();
+    string_is_key_ = is_key;
+    high_surrogate_ = 0;
+    state_ = State::STRING;
+  }
+
+  template <typename Handler>
+  void end_string(Handler &h) {
+    if (string_is_key_) {
+      h.on_key(std::string_view(buf_));
+      state_ = State::COLON;
+    } else {
+      h.on_string(std::string_view(buf_));
+      after_value();
+    }
+  }
+
+  template <typename Handler>
+  void end_literal(Handler &h) {
+    if (buf_ == "null")
+      h.on_literal(Literal::IS_NULL);
+    else if (buf_ == "true")
+      h.on_literal(Literal::IS_TRUE);
+    else if (buf_ == "false")
+      h.on_literal(Literal::IS_FALSE);
+    else {
+      failed_ = true;
+      return;
+    }
+    after_value();
+  }
+
+  void after_value() { state_ = stack_.empty() ? State::DONE : State::AFTER_VALUE; }
+
+  void append_code_point(uint32_t cp) {
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+      high_surrogate_ = cp;
+      return;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF && high_surrogate_) {
+      cp = 0x10000 + ((high_surrogate_ - 0xD800) << 10) + (cp - 0xDC00);
+    }
+    high_surrogate_ = 0;
+    if (cp < 0x80) {
+      buf_ += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      buf_ += static_cast<char>(0xC0 | (cp >> 6));
+      buf_ += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      buf_ += static_cast<char>(0xE0 | (cp >> 12));
+      buf_ += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      buf_ += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      buf_ += static_cast<char>(0xF0 | (cp >> 18));
+      buf_ += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      buf_ += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      buf_ += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  State state_ = State::VALUE;
+  std::vector<char> stack_; // '{' / '['
+  std::string buf_;         // 当前 token (跨分片续接, 复用不释放)
+  bool failed_ = false;
+  bool string_is_key_ = false;
+  int unicode_digits_ = 0;
+  uint32_t unicode_code_ = 0;
+  uint32_t high_surrogate_ = 0;
+};
+
+// ============================================================================
+// PageDecoder - GraphQL 响应 → ColumnBatch
+// ============================================================================
+enum class PageStatus : uint8_t {
+  OK,
+  JSON_ERROR,    // 响应不是完整 JSON
+  GRAPHQL_ERROR, // 响应包含 errors
+  FORMAT_ERROR,  // data 中缺少目标数组
+};
+
+class PageDecoder {
+public:
+  PageDecoder() = default;
+  PageDecoder(const PageDecoder &) = delete;
+  PageDecoder &operator=(const PageDecoder &) = delete;
+  PageDecoder(PageDecoder &&) = default;
+  PageDecoder &operator=(PageDecoder &&) = default;
+
+  // 开始解码新响应: 清空 target 与解析状态
+  void reset() {
+    parser_.reset();
+    targets_.clear();
+    error_messages_.clear();
+    depth_ = 0;
+    section_ = Section::OTHER;
+    target_ = -1;
+    rows_open_ = false;
+    row_open_ = false;
+    col_ = -1;
+    in_ref_ = false;
+    ref_is_id_ = false;
+    errors_key_message_ = false;
+    has_errors_ = false;
+    capture_depth_ = 0;
+    capture_first_.clear();
+    capture_after_key_ = false;
+  }
+
+  // data 下名为 key 的数组 → 追加到 out (out 已 bind 到对应 entity)
+  void add_target(std::string_view key, ColumnBatch *out) {
+    assert(out && out->entity());
+    targets_.push_back({std::string(key), out, out->size(), false});
+  }
+
+  void feed(const char *data, size_t n) { parser_.feed(*this, data, n); }
+
+  // 结束解码; 非 OK 时回滚所有 target 到解码前的行数
+  PageStatus finish() {
+    parser_.finish(*this);
+    PageStatus status = PageStatus::OK;
+    if (!parser_.complete()) {
+      status = PageStatus::JSON_ERROR;
+    } else if (has_errors_) {
+      status = PageStatus::GRAPHQL_ERROR;
+    } else {
+      for (const auto &t : targets_) {
+        if (!t.seen)
+          status = PageStatus::FORMAT_ERROR;
+      }
+    }
+    if (status != PageStatus::OK) {
+      for (auto &t : targets_)
+        t.out->truncate(t.start_rows);
+    }
+    return status;
+  }
+
+  // 传输中断: 丢弃已解码的半页
+  void abort() {
+    for (auto &t : targets_)
+      t.out->truncate(t.start_rows);
+    parser_.reset();
+  }
+
+  // 第 i 个 target 本页解码出的行数
+  size_t rows(size_t i) const { return targets_[i].out->size() - targets_[i].start_rows; }
+  size_t start_row(size_t i) const { return targets_[i].start_rows; }
+
+  // errors[*].message (用于 bad indexers 归因)
+  const std::vector<std::string> &error_messages() const { return error_messages_; }
+
+  // ==========================================================================
+  // SAX 事件 (由 JsonPushParser 回调)
+  // ==========================================================================
+  void on_begin_object() {
+    if (capture_depth_) {
+      capture_open('{');
+    } else if (depth_ == 3 && rows_open_) {
+      row_open_ = true;
+      cur().begin_row();
+    } else if (depth_ == 4 && row_open_ && col_ >= 0) {
+      auto t = cur().type(col_);
+      if (t == entities::ColumnType::REF)
+        in_ref_ = true;
+      else if (t == entities::ColumnType::JSON)
+        capture_begin('{');
+    }
+    ++depth_;
+  }
+
+  void on_end_object() {
+    --depth_;
+    if (capture_depth_) {
+      capture_close('}');
+    } else if (depth_ == 3 && row_open_) {
+      cur().end_row();
+      row_open_ = false;
+    } else if (depth_ == 4 && in_ref_) {
+      in_ref_ = false;
+    }
+    if (depth_ == 4)
+      col_ = -1;
+  }
+
+  void on_begin_array() {
+    if (capture_depth_) {
+      capture_open('[');
+    } else if (depth_ == 2 && section_ == Section::DATA && target_ >= 0) {
+      rows_open_ = true;
+      targets_[target_].seen = true;
+    } else if (depth_ == 4 && row_open_ && col_ >= 0 &&
+               cur().type(col_) == entities::ColumnType::JSON) {
+      capture_begin('[');
+    }
+    ++depth_;
+  }
+
+  void on_end_array() {
+    --depth_;
+    if (capture_depth_) {
+      capture_close(']');
+    } else if (depth_ == 2 && rows_open_) {
+      rows_open_ = false;
+      target_ = -1;
+    }
+    if (depth_ == 4)
+      col_ = -1;
+  }
+
+  void on_key(std::string_view key) {
+    if (capture_depth_) {
+      capture_sep();
+      capture_string(key);
+      cur().append_text(col_, ':');
+      capture_after_key_ = true;
+      return;
+    }
+    if (depth_ == 1) {
+      if (key == "data") {
+        section_ = Section::DATA;
+      } else if (key == "errors") {
+        section_ = Section::ERRORS;
+        has_errors_ = true;
+      } else {
+        section_ = Section::OTHER;
+      }
+    } else if (depth_ == 2 && section_ == Section::DATA) {
+      target_ = find_target(key);
+    } else if (depth_ == 4 && row_open_) {
+      col_ = find_column(key);
+    } else if (depth_ == 5 && in_ref_) {
+      ref_is_id_ = (key == "id");
+    }
+    if (section_ == Section::ERRORS)
+      errors_key_message_ = (key == "message");
+  }
+
+  void on_string(std::string_view v) {
+    if (capture_depth_) {
+      capture_sep();
+      capture_string(v);
+      return;
+    }
+    if (depth_ == 4 && row_open_ && col_ >= 0) {
+      set_scalar(v, true);
+      col_ = -1;
+    } else if (depth_ == 5 && in_ref_ && ref_is_id_) {
+      cur().set_text(col_, v);
+    } else if (section_ == Section::ERRORS && errors_key_message_) {
+      error_messages_.emplace_back(v);
+      errors_key_message_ = false;
+    }
+  }
+
+  void on_number(std::string_view v) {
+    if (capture_depth_) {
+      capture_sep();
+      cur().append_text(col_, v);
+      return;
+    }
+    if (depth_ == 4 && row_open_ && col_ >= 0) {
+      set_scalar(v, false);
+      col_ = -1;
+    }
+  }
+
+  void on_literal(Literal lit) {
+    if (capture_depth_) {
+      capture_sep();
+      cur().append_text(col_, lit == Literal::IS_NULL ? "null" : (lit == Literal::IS_TRUE ? "true" : "false"));
+      return;
+    }
+    if (depth_ == 4 && row_open_ && col_ >= 0) {
+      if (lit == Literal::IS_NULL)
+        cur().set_null(col_);
+      else if (!is_fixed(cur().type(col_)))
+        cur().set_text(col_, lit == Literal::IS_TRUE ? "true" : "false");
+      col_ = -1;
+    }
+  }
+
+private:
+  enum class Section : uint8_t { OTHER, DATA, ERRORS };
+
+  struct Target {
+    std::string key;
+    ColumnBatch *out;
+    size_t start_rows;
+    bool seen;
+  };
+
+  static bool is_fixed(entities::ColumnType t) {
+    return t == entities::ColumnType::INT || t == entities::ColumnType::DECIMAL;
+  }
+
+  ColumnBatch &cur() { return *targets_[target_].out; }
+
+  int find_target(std::string_view key) const {
+    for (size_t i = 0; i < targets_.size(); ++i) {
+      if (targets_[i].key == key)
+        return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  int find_column(std::string_view key) const {
+    const auto &schema = targets_[target_].out->entity()->schema;
+    for (size_t i = 0; i < schema.size(); ++i) {
+      if (key == schema[i].field)
+        return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // 标量值 → 列 (is_string: JSON 中带引号)
+  void set_scalar(std::string_view v, bool is_string) {
+    auto &b = cur();
+    switch (b.type(col_)) {
+    case entities::ColumnType::INT: {
+      int64_t x = 0;
+      auto [end, ec] = std::from_chars(v.data(), v.data() + v.size(), x);
+      if (ec == std::errc{} && end == v.data() + v.size()) {
+        b.set_int(col_, x);
+      } else {
+        // 浮点写法("1.7e9" 等)截断取整; NaN/超出 int64 的值转换是未定义行为, 与无法解析一样存 NULL
+        double d = 0.0;
+        auto [dend, dec] = std::from_chars(v.data(), v.data() + v.size(), d);
+        if (dec == std::errc{} && dend == v.data() + v.size() && d >= -0x1p63 && d < 0x1p63)
+          b.set_int(col_, static_cast<int64_t>(d));
+        else
+          b.set_null(col_);
+      }
+      break;
+    }
+    case entities::ColumnType::DECIMAL: {
+      double d = 0.0;
+      auto [end, ec] = std::from_chars(v.data(), v.data() + v.size(), d);
+      if (ec == std::errc{} && end == v.data() + v.size())
+        b.set_double(col_, d);
+      else
+        b.set_null(col_);
+      break;
+    }
+    case entities::ColumnType::JSON:
+      b.open_text(col_);
+      if (is_string)
+        append_json_string(b, v);
+      else
+        b.append_text(col_, v);
+      b.close_text(col_);
+      break;
+    default:
+      b.set_text(col_, v);
+      break;
+    }
+  }
+
+  // ==========================================================================
+  // JSON 列原文捕获 (紧凑序列化, 与 json::dump() 一致)
+  // ==========================================================================
+  void capture_begin(char open) {
+    capture_depth_ = depth_ + 1;
+    capture_first_.assign(1, true);
+    capture_after_key_ = false;
+    cur().open_text(col_);
+    cur().append_text(col_, open);
+  }
+
+  void capture_open(char open) {
+    capture_sep();
+    capture_first_.push_back(true);
+    cur().append_text(col_, open);
+  }
+
+  // 调用前 depth_ 已递减
+  void capture_close(char close) {
+    cur().append_text(col_, close);
+    capture_first_.pop_back();
+    if (depth_ + 1 == capture_depth_) {
+      cur().close_text(col_);
+      capture_depth_ = 0;
+      col_ = -1;
+    }
+  }
+
+  void capture_sep() {
+    if (capture_after_key_) {
+      capture_after_key_ = false;
+      return;
+    }
+    if (!capture_first_.back())
+      cur().append_text(col_, ',');
+    capture_first_.back() = false;
+  }
+
+  void capture_string(std::string_view v) { append_json_string(cur(), v); }
+
+  void append_json_string(ColumnBatch &b, std::string_view v) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    b.append_text(col_, '"');
+    for (char c : v) {
+      switch (c) {
+      case '"': b.append_text(col_, "\\\""); break;
+      case '\\': b.append_text(col_, "\\\\"); break;
+      case '\b': b.append_text(col_, "\\b"); break;
+      case '\f': b.append_text(col_, "\\f"); break;
+      case '\n': b.append_text(col_, "\\n"); break;
+      case '\r': b.append_text(col_, "\\r"); break;
+      case '\t': b.append_text(col_, "\\t"); break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char esc[] = {'\\', 'u', '0', '0', kHex[(c >> 4) & 0xF], kHex[c & 0xF]};
+          b.append_text(col_, std::string_view(esc, sizeof(esc)));
+        } else {
+          b.append_text(col_, c);
+        }
+        break;
+      }
+    }
+    b.append_text(col_, '"');
+  }
+
+  JsonPushParser parser_;
+  std::vector<Target> targets_;
+  std::vector<std::string> error_messages_;
+
+  int depth_ = 0;
+  Section section_ = Section::OTHER;
+  int target_ = -1;   // 当前 data key 对应的 target
+  bool rows_open_ = false;
+  bool row_open_ = false;
+  int col_ = -1;      // 当前字段对应的列
+  bool in_ref_ = false;
+  bool ref_is_id_ = false;
+  bool errors_key_message_ = false;
+  bool has_errors_ = false;
+
+  int capture_depth_ = 0; // >0: 正在捕获 JSON 列, 值为捕获根的 depth
+  std::vector<bool> capture_first_;
+  bool capture_after_key_ = false;
+};
+
+} // namespace graphql
@@ -0,0 +1,68 @@
+#pragma once
+
+// ============================================================================
+// PageSizeController - 单个执行器的 first: 自适应(AIMD)
+//   满页且快 → 加性增大; 慢页/失败 → 乘性减小; 再按实测每行字节数封顶单页响应体积
+// ============================================================================
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define PAGE_SIZE_MIN 50
+#define PAGE_SIZE_STEP_DIV 8             // 加性增量 = ceiling / 8
+#define PAGE_TARGET_LATENCY_MS 1500      // 低于此延时的满页才增大
+#define PAGE_SLOW_LATENCY_MS 5000        // 高于此延时减小
+#define PAGE_MAX_BYTES (8 * 1024 * 1024) // 单页响应体积上限
+
+class PageSizeController {
+public:
+  explicit PageSizeController(int ceiling)
+      : ceiling_(std::max(ceiling, PAGE_SIZE_MIN)), size_(ceiling_) {}
+
+  int size() const { return size_; }
+  int ceiling() const { return ceiling_; }
+
+  // 当前页大小下的响应体积预估(尚无实测时按单页上限)
+  size_t estimate_bytes() const {
+    if (bytes_per_row_ <= 0.0)
+      return PAGE_MAX_BYTES;
+    return static_cast<size_t>(bytes_per_row_ * size_);
+  }
+
+  // requested: 本页请求的 first:, rows/bytes: 实际返回
+  void on_success(int requested, size_t rows, size_t bytes, int64_t latency_ms) {
+    if (rows > 0) {
+      double bpr = static_cast<double>(bytes) / static_cast<double>(rows);
+      bytes_per_row_ = (bytes_per_row_ == 0.0) ? bpr : bytes_per_row_ * 0.8 + bpr * 0.2;
+    }
+
+    if (latency_ms > PAGE_SLOW_LATENCY_MS) {
+      decrease();
+    } else if (latency_ms < PAGE_TARGET_LATENCY_MS && static_cast<int>(rows) >= requested) {
+      size_ = std::min(ceiling_, size_ + std::max(1, ceiling_ / PAGE_SIZE_STEP_DIV));
+    }
+    clamp_bytes();
+  }
+
+  // 失败(超时/indexer 报错/截断)都视为过载信号
+  void on_failure() { decrease(); }
+
+private:
+  void decrease() { size_ = std::max(PAGE_SIZE_MIN, size_ / 2); }
+
+  void clamp_bytes() {
+    if (bytes_per_row_ <= 0.0)
+      return;
+    int cap = static_cast<int>(PAGE_MAX_BYTES / bytes_per_row_);
+    size_ = std::clamp(std::min(size_, cap), PAGE_SIZE_MIN, ceiling_);
+  }
+
+  int ceiling_;
+  int size_;
+  double bytes_per_row_ = 0.0; // EWMA
+};
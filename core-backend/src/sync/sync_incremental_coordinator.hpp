@@ -4,13 +4,16 @@
 // 小sync - 全局协调器（最外层，依赖 Scheduler）
 // ============================================================================
 
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include <boost/asio.hpp>
 
 #include "../core/config.hpp"
 #include "../core/database.hpp"
+#include "../core/ingest_writer.hpp"
 #include "../infra/https_pool.hpp"
 #include "../stats/stats_manager.hpp"
 #include "sync_incremental_scheduler.hpp"
@@ -21,11 +24,15 @@ namespace asio = boost::asio;
 
 // ============================================================================
 // SyncIncrementalCoordinator - 全局协调器（周期性小sync）
+// 调度器首轮前建一次并常驻(建表/计数/统计加载只在启动时做), 之后每轮只重新 start()
+// continuous = true 时无轮次, 各 entity 独立轮询(见 SyncIncrementalScheduler)
 // ============================================================================
 class SyncIncrementalCoordinator {
 public:
-  SyncIncrementalCoordinator(const Config &config, Database &db, HttpsPool &pool)
-      : config_(config), db_(db), pool_(pool), sync_interval_(config.sync_interval_seconds) {
+  SyncIncrementalCoordinator(const Config &config, Database &db, HttpsPool &pool, IngestWriter &writer,
+                             PageArchive *archive = nullptr)
+      : config_(config), db_(db), pool_(pool), writer_(writer), archive_(archive), sync_interval_(config.sync_interval_seconds),
+        continuous_(config.continuous) {
     db_.init_sync_state();
     StatsManager::instance().set_database(&db_);
   }
@@ -35,24 +42,31 @@ public:
     start_sync_round();
   }
 
+  // 每轮全部 source 完成时回调(io 线程, 下一轮计时之前; 基准据此计时)
+  void set_on_round_done(std::function<void()> cb) { on_round_done_ = std::move(cb); }
+
 private:
   void start_sync_round() {
-    schedulers_.clear();
     total_active_ = 0;
     done_source_count_ = 0;
 
-    schedulers_.reserve(config_.sources.size());
-    for (const auto &src : config_.sources) {
-      schedulers_.emplace_back(
-          src, db_, pool_,
-          [this]() -> bool { return try_acquire_slot(); },
-          [this]() { release_slot(); },
-          [this]() { on_source_done(); });
+    if (schedulers_.empty()) {
+      // 调度器持有执行器并被回调捕获 this, 需地址稳定
+      schedulers_.reserve(config_.sources.size());
+      for (const auto &src : config_.sources) {
+        schedulers_.push_back(std::make_unique<SyncIncrementalScheduler>(
+            src, db_, pool_, writer_,
+            [this]() -> bool { return try_acquire_slot(); },
+            [this]() { release_slot(); },
+            [this]() { on_source_done(); },
+            continuous_, sync_interval_, archive_));
+      }
     }
 
-    std::cout << "[Puller] 开始 sync, 共 " << schedulers_.size() << " 个 source" << std::endl;
+    std::cout << "[Puller] 开始 " << (continuous_ ? "持续 " : "") << "sync, 共 "
+              << schedulers_.size() << " 个 source" << std::endl;
     for (auto &s : schedulers_) {
-      s.start();
+      s->start();
     }
   }
 
@@ -69,11 +83,15 @@ private:
   }
 
   void on_source_done() {
+    if (continuous_)
+      return; // 持续模式无轮次
     ++done_source_count_;
     if (done_source_count_ < static_cast<int>(schedulers_.size()))
       return;
 
     std::cout << "[Puller] 本轮 sync 完成, " << sync_interval_ << "s 后开始下一轮" << std::endl;
+    if (on_round_done_)
+      on_round_done_();
     schedule_next_round();
   }
 
@@ -90,10 +108,14 @@ private:
   const Config &config_;
   Database &db_;
   HttpsPool &pool_;
+  IngestWriter &writer_;
+  PageArchive *archive_;
   asio::io_context *ioc_ = nullptr;
+  std::function<void()> on_round_done_;
 
-  std::vector<SyncIncrementalScheduler> schedulers_;
+  std::vector<std::unique_ptr<SyncIncrementalScheduler>> schedulers_;
   int total_active_ = 0;
   int done_source_count_ = 0;
   int sync_interval_;
+  bool continuous_;
 };
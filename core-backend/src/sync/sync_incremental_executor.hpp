@@ -4,20 +4,30 @@
 // 小sync - Entity执行器（最内层，无外部依赖）
 // ============================================================================
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <ctime>
+#include <deque>
 #include <functional>
 #include <iostream>
-#include <nlohmann/json.hpp>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "../core/column_batch.hpp"
+#include "../core/config.hpp"
 #include "../core/database.hpp"
 #include "../core/entity_definition.hpp"
+#include "../core/ingest_writer.hpp"
+#include "../core/memory_budget.hpp"
 #include "../infra/https_pool.hpp"
 #include "../stats/stats_manager.hpp"
-
-using json = nlohmann::json;
+#include "page_archive.hpp"
+#include "page_batcher.hpp"
+#include "page_decoder.hpp"
+#include "page_size_controller.hpp"
 
 // ============================================================================
 // GraphQL 工具
@@ -52,12 +62,47 @@ inline std::string build_target(const std::string &subgraph_id) {
 
 } // namespace graphql
 
+// ============================================================================
+// 分片游标: 每个分片一行 sync_state, entity 列 = "<Entity><kind><hi>"
+//   BACKFILL: 冷启动把 [min_ts, now) 切成 N 段, 尾部游标同时置为 now,
+//             分片全部追平后即收敛为唯一的尾部游标
+//   REFRESH : ID 模式全量重拉, 按 id 十六进制前缀切成 K 段写入暂存表, 全部完成后换表
+// 分片追平后删除自己的游标行; 重启时按残留行续拉
+// ============================================================================
+namespace shard {
+
+inline constexpr const char *BACKFILL = "@backfill:";
+inline constexpr const char *REFRESH = "@refresh:";
+
+inline std::string key_prefix(const char *entity_name, const char *kind) {
+  return std::string(entity_name) + kind;
+}
+
+inline std::string cursor_key(const char *entity_name, const char *kind, const std::string &hi) {
+  return key_prefix(entity_name, kind) + hi;
+}
+
+inline std::string hi_from_key(const char *entity_name, const char *kind, const std::string &key) {
+  auto prefix = key_prefix(entity_name, kind);
+  assert(key.compare(0, prefix.size(), prefix) == 0);
+  return key.substr(prefix.size());
+}
+
+} // namespace shard
+
+// 分片执行器参数(cursor_key 为空 = 尾部执行器)
+struct ShardSpec {
+  std::string cursor_key; // sync_state.entity 列
+  std::string hi;         // order_field 上界(不含), 空 = 无上界
+  std::string table;      // 写入表, 空 = entity 表
+};
+
 // ============================================================================
 // 宏配置
 // ============================================================================
-#define GRAPHQL_BATCH_SIZE 1000
 #define PULL_RETRY_DELAY_MS 50
 #define PULL_RETRY_MAX_DELAY_MS 200
+#define PULL_SKIP_MAX 5000 // gateway 接受的最大 skip
 
 // ============================================================================
 // SyncIncrementalExecutor - 单个 entity 的拉取执行器
@@ -65,190 +110,616 @@ inline std::string build_target(const std::string &subgraph_id) {
 class SyncIncrementalExecutor {
 public:
   using DoneCallback = std::function<void()>;
+  using ShardStart = std::pair<std::string, SyncCursor>; // (shard.hi, 起始游标)
+  using BackfillCallback = std::function<void(const std::vector<ShardStart> &shards)>;
 
+  // shard 非空: 分片执行器, 只拉 [游标, shard.hi) 且追平后删除自己的游标行
+  // on_backfill 非空: 尾部执行器, 冷启动且 backfill_shards > 1 时先规划分片再回调
   SyncIncrementalExecutor(const std::string &subgraph_id, const std::string &source_name,
-                          const entities::EntityDef *entity, Database &db, HttpsPool &pool,
-                          DoneCallback on_done)
-      : source_name_(source_name), entity_(entity), db_(db), pool_(pool),
-        on_done_(std::move(on_done)), target_(graphql::build_target(subgraph_id)) {
-    buffer_.reserve(GRAPHQL_BATCH_SIZE);
+                          const entities::EntityDef *entity, const EntityOptions &options,
+                          Database &db, HttpsPool &pool, IngestWriter &writer, DoneCallback on_done,
+                          ShardSpec shard = {}, BackfillCallback on_backfill = {})
+      : source_name_(source_name), entity_(entity), options_(options), db_(db), pool_(pool), writer_(writer),
+        on_done_(std::move(on_done)), on_backfill_(std::move(on_backfill)),
+        target_(graphql::build_target(subgraph_id)), shard_(std::move(shard)),
+        cursor_key_(shard_.cursor_key.empty() ? std::string(entity->name) : shard_.cursor_key),
+        table_(shard_.table.empty() ? std::string(entity->table) : shard_.table),
+        buffer_(entity), staged_(entity), order_col_(entities::find_column(entity, entity->order_field)),
+        id_col_(entities::find_column(entity, "id")), page_size_(options.max_page_size) {
+    assert(order_col_ >= 0 && "order_field missing from schema");
+    assert(id_col_ >= 0 && "id missing from schema");
+    assert((!is_shard() || entity->sync_mode == entities::SyncMode::KEYSET ||
+            entity->sync_mode == entities::SyncMode::ID) &&
+           "shards require KEYSET or ID");
+    buffer_.reserve(options.max_page_size);
+    staged_.reserve(options.max_page_size);
   }
 
+  // 规划方已给出起始游标(其写库排在本执行器的页之前): 启动时不再读库
+  void set_cursor(const SyncCursor &cursor) {
+    cursor_ = cursor;
+    cursor_loaded_ = true;
+  }
+
+  // 游标只在首次启动时读库, 之后以内存为准(与落盘同步推进)
   void start() {
-    auto cursor = db_.get_cursor(source_name_, entity_->name);
-    cursor_value_ = cursor.value;
-    cursor_skip_ = cursor.skip;
-    StatsManager::instance().start_sync(source_name_, entity_->name);
-
-    std::cout << "[Pull] " << source_name_ << "/" << entity_->name
-              << " start; cursor=" << (cursor_value_.empty() ? "(empty)" : cursor_value_.substr(0, 20) + "...")
-              << " skip=" << cursor_skip_ << std::endl;
-    send_request();
+    if (!cursor_loaded_) {
+      cursor_ = db_.get_cursor(source_name_, cursor_key_);
+      cursor_loaded_ = true;
+    }
+    committed_cursor_ = cursor_;
+    if (!is_shard())
+      StatsManager::instance().start_sync(source_name_, entity_->name);
+
+    std::cout << "[Pull] " << source_name_ << "/" << cursor_key_
+              << " start; cursor=" << (cursor_.value.empty() ? "(empty)" : cursor_.value.substr(0, 20) + "...")
+              << " skip=" << cursor_.skip
+              << (cursor_.id.empty() ? "" : " id=" + cursor_.id.substr(0, 20) + "...") << std::endl;
+    inflight_pages_ = 0;
+    next_blocked_ = false;
+    finish_pending_ = false;
+    done_ = false;
+    run_rows_ = 0;
+    run_full_pages_ = 0;
+
+    // 冷启动: 先探测最早时间戳, 规划分片后尾部从 now 起拉
+    if (on_backfill_ && cursor_.value.empty() && options_.backfill_shards > 1 &&
+        entity_->sync_mode == entities::SyncMode::KEYSET) {
+      probing_ = true;
+      send_page_request();
+      return;
+    }
+    send_request_when_writable();
   }
 
   bool is_done() const { return done_; }
+  bool is_shard() const { return !shard_.cursor_key.empty(); }
+  bool is_refresh_shard() const { return !shard_.table.empty(); }
   const char *name() const { return entity_->name; }
 
+  // 最近一次 start() 以来拉到的行数 / 满页数(持续模式据此调整轮询间隔)
+  int64_t run_rows() const { return run_rows_; }
+  int run_full_pages() const { return run_full_pages_; }
+
+  // 合批模式: 之后的分页请求(探测除外)经 batcher 与同 subgraph 的其它 entity 合并发送
+  void set_batcher(PageBatcher *batcher) { batcher_ = batcher; }
+
+  // 归档: 响应 body(单独请求时由本执行器写, 合批时由 batcher 写) + 每页游标
+  void set_archive(PageArchive *archive) { archive_ = archive; }
+
 private:
-  void send_request() {
+  // reserved: 本页占用的内存预算, 落盘完成(或空页)时释放
+  void send_request(size_t reserved) {
+    ++inflight_pages_;
+    reserved_.push_back(reserved);
+    send_page_request();
+  }
+
+  void send_page_request() {
+    int width = fanout_width();
+    if (width > 1) {
+      send_fanout(width);
+      return;
+    }
+
+    request_limit_ = probing_ ? 1 : page_size_.size();
+    page_bytes_ = 0;
+    page_body_.clear();
+    request_start_ = std::chrono::steady_clock::now();
+    StatsManager::instance().set_api_state(source_name_, entity_->name, ApiState::CALLING);
+
+    if (batcher_ && !probing_) {
+      batcher_->submit(build_selection(), &buffer_, [this](const PageBatcher::Result &r) {
+        auto &stats = StatsManager::instance();
+        page_bytes_ = r.bytes.plain;
+        stats.record_transfer(source_name_, entity_->name, r.bytes.wire, r.bytes.plain);
+        stats.set_api_state(source_name_, entity_->name, ApiState::PROCESSING);
+        on_page(r.success, r.status, r.rows, r.start_row, r.error_messages);
+      });
+      return;
+    }
+
     std::string query = build_query();
+    // 流式解码: body 分片直接喂给 decoder_ → buffer_ 列缓冲(失败时回滚本页)
+    decoder_.reset();
+    decoder_.add_target(entity_->plural, &buffer_);
+    hedge_decoded_ = false;
+    int64_t hedge_after_ms =
+        options_.hedge ? StatsManager::instance().get_latency_p95(source_name_, entity_->name) : 0;
+    pool_.async_post_stream(
+        target_, query,
+        [this](const char *data, size_t n) {
+          page_bytes_ += n;
+          if (archive_ && !probing_)
+            page_body_.append(data, n);
+          decoder_.feed(data, n);
+        },
+        [this](bool success, const TransferBytes &bytes) {
+          auto &stats = StatsManager::instance();
+          stats.record_transfer(source_name_, entity_->name, bytes.wire, bytes.plain);
+          stats.set_api_state(source_name_, entity_->name, ApiState::PROCESSING);
+          on_response(success);
+        },
+        hedge_after_ms,
+        [this](const std::string &body) {
+          // 对冲请求不流式: 每份完整 body 重新解码到 buffer_(失败时 finish 已回滚), 解码成功才算可用
+          hedge_status_ = decode_body(decoder_, &buffer_, body);
+          hedge_decoded_ = true;
+          page_bytes_ = body.size();
+          if (archive_ && !probing_)
+            page_body_ = body;
+          return hedge_status_ == graphql::PageStatus::OK;
+        });
+  }
+
+  graphql::PageStatus decode_body(graphql::PageDecoder &decoder, ColumnBatch *out, const std::string &body) {
+    decoder.reset();
+    decoder.add_target(entity_->plural, out);
+    decoder.feed(body.data(), body.size());
+    return decoder.finish();
+  }
+
+  // 热点时间戳扇出宽度: 上一页整页落在游标时间戳上(skip 在增长)时, 后续 skip_fanout 个偏移并发请求;
+  // 受 PULL_SKIP_MAX 约束, 不足 2 个时仍逐页
+  int fanout_width() const {
+    if (options_.skip_fanout <= 1 || !dense_ || probing_)
+      return 1;
+    int room = (PULL_SKIP_MAX - cursor_.skip) / page_size_.size() + 1;
+    return std::clamp(room, 1, options_.skip_fanout);
+  }
+
+  // 扇出: 同一 where、skip 依次相差一页的 width 个请求(合批模式下也直连发出), 各自解码到独立缓冲,
+  // 全部返回后按 skip 顺序拼成一页交 on_page, 游标/落盘/预取与单页相同
+  void send_fanout(int width) {
+    slot_limit_ = page_size_.size();
+    request_limit_ = slot_limit_ * width;
+    page_bytes_ = 0;
     request_start_ = std::chrono::steady_clock::now();
     StatsManager::instance().set_api_state(source_name_, entity_->name, ApiState::CALLING);
 
-    pool_.async_post(target_, query, [this](std::string body) {
-      StatsManager::instance().set_api_state(source_name_, entity_->name, ApiState::PROCESSING);
-      on_response(body);
-    });
+    while (static_cast<int>(fanout_.size()) < width)
+      fanout_.push_back(std::make_unique<FanoutSlot>(entity_));
+    fanout_pending_ = width;
+    int64_t hedge_after_ms =
+        options_.hedge ? StatsManager::instance().get_latency_p95(source_name_, entity_->name) : 0;
+
+    for (int i = 0; i < width; ++i) {
+      auto &slot = *fanout_[i];
+      slot.rows.clear();
+      slot.body.clear();
+      slot.bytes = 0;
+      slot.decoded = false;
+      slot.decoder.reset();
+      slot.decoder.add_target(entity_->plural, &slot.rows);
+      std::string query = R"({"query":"{)" + build_selection(slot_limit_, cursor_.skip + i * slot_limit_) + R"(}"})";
+      pool_.async_post_stream(
+          target_, query,
+          [this, i](const char *data, size_t n) {
+            auto &s = *fanout_[i];
+            s.bytes += n;
+            if (archive_)
+              s.body.append(data, n);
+            s.decoder.feed(data, n);
+          },
+          [this, i, width](bool success, const TransferBytes &bytes) {
+            StatsManager::instance().record_transfer(source_name_, entity_->name, bytes.wire, bytes.plain);
+            auto &s = *fanout_[i];
+            s.success = success;
+            if (!success) {
+              s.status = graphql::PageStatus::OK;
+              s.decoder.abort();
+            } else if (!s.decoded) {
+              s.status = s.decoder.finish();
+            }
+            if (--fanout_pending_ == 0)
+              on_fanout_done(width);
+          },
+          hedge_after_ms,
+          [this, i](const std::string &body) {
+            auto &s = *fanout_[i];
+            s.status = decode_body(s.decoder, &s.rows, body);
+            s.decoded = true;
+            s.bytes = body.size();
+            if (archive_)
+              s.body = body;
+            return s.status == graphql::PageStatus::OK;
+          });
+    }
+  }
+
+  // 任一请求失败则整组作废按失败重试; 否则拼接到第一个不满的片为止(其后各片应为空)
+  void on_fanout_done(int width) {
+    StatsManager::instance().set_api_state(source_name_, entity_->name, ApiState::PROCESSING);
+    for (int i = 0; i < width; ++i) {
+      auto &s = *fanout_[i];
+      if (!s.success || s.status != graphql::PageStatus::OK) {
+        on_page(s.success, s.status, 0, 0, s.decoder.error_messages());
+        return;
+      }
+    }
+
+    size_t start_row = buffer_.size();
+    bool archived = false;
+    for (int i = 0; i < width; ++i) {
+      auto &s = *fanout_[i];
+      size_t rows = s.decoder.rows(0);
+      if (archive_ && rows > 0) { // 各片写成同一页的连续 BODY, 重灌时拼接后由 PAGE 一并落盘
+        archive_->write_body(source_name_, {{entity_->plural, entity_->table}}, std::move(s.body), archived);
+        archived = true;
+      }
+      buffer_.append(s.rows);
+      s.rows.clear();
+      page_bytes_ += s.bytes;
+      if (static_cast<int>(rows) < slot_limit_)
+        break;
+    }
+    merged_page_ = true;
+    on_page(true, graphql::PageStatus::OK, buffer_.size() - start_row, start_row, {});
+    merged_page_ = false;
+  }
+
+  void on_response(bool success) {
+    auto status = !success ? graphql::PageStatus::OK : hedge_decoded_ ? hedge_status_ : decoder_.finish();
+    if (!success)
+      decoder_.abort();
+    if (archive_ && success && status == graphql::PageStatus::OK && !probing_ && decoder_.rows(0) > 0)
+      archive_->write_body(source_name_, {{entity_->plural, entity_->table}}, std::move(page_body_));
+    on_page(success, status, decoder_.rows(0), decoder_.start_row(0), decoder_.error_messages());
   }
 
-  void on_response(const std::string &body) {
+  // 本页结果(单独请求或合批解复用): 行位于 buffer_ 的 [start_row, start_row + rows)
+  void on_page(bool success, graphql::PageStatus status, size_t page_rows, size_t start_row,
+               const std::vector<std::string> &error_messages) {
     auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                           std::chrono::steady_clock::now() - request_start_)
                           .count();
 
     auto &stats = StatsManager::instance();
 
-    if (body.empty()) {
+    if (!success || status != graphql::PageStatus::OK) {
+      page_size_.on_failure();
+      stats.set_page_size(source_name_, entity_->name, page_size_.size());
+    }
+
+    if (!success) {
       stats.record_failure(source_name_, entity_->name, FailureKind::NETWORK, latency_ms);
       do_retry("network fail");
       return;
     }
 
-    json j;
-    try {
-      j = json::parse(body);
-    } catch (...) {
+    switch (status) {
+    case graphql::PageStatus::JSON_ERROR:
       stats.record_failure(source_name_, entity_->name, FailureKind::JSON, latency_ms);
+      pool_.report_failure(FailureKind::JSON);
       do_retry("JSON parse fail");
       return;
-    }
-
-    if (j.contains("errors")) {
+    case graphql::PageStatus::GRAPHQL_ERROR:
       stats.record_failure(source_name_, entity_->name, FailureKind::GRAPHQL, latency_ms);
-      parse_indexer_errors(j["errors"], stats);
+      pool_.report_failure(FailureKind::GRAPHQL);
+      parse_indexer_errors(error_messages, stats);
       do_retry("GraphQL error");
       return;
-    }
-
-    if (!j.contains("data") || !j["data"].contains(entity_->plural)) {
+    case graphql::PageStatus::FORMAT_ERROR:
       stats.record_failure(source_name_, entity_->name, FailureKind::FORMAT, latency_ms);
+      pool_.report_failure(FailureKind::FORMAT);
       do_retry("format error");
       return;
+    case graphql::PageStatus::OK:
+      break;
     }
 
-    auto &items = j["data"][entity_->plural];
-    stats.record_success(source_name_, entity_->name, items.size(), latency_ms);
     retry_count_ = 0;
 
-    if (items.empty()) {
-      if (!buffer_.empty())
-        flush_buffer();
-      finish_sync();
+    // 本执行器有页写库失败: 在途页作废(不推进游标), 全部回来后从最后落盘的游标重拉
+    if (write_failed_) {
+      buffer_.clear();
+      --inflight_pages_;
+      MemoryBudget::instance().release(reserved_.back());
+      reserved_.pop_back();
+      recover_if_idle();
       return;
     }
 
-    update_cursor(items);
+    if (probing_) {
+      stats.record_success(source_name_, entity_->name, 0, latency_ms);
+      on_probe(page_rows, start_row);
+      return;
+    }
 
-    for (const auto &item : items) {
-      std::string values = entity_->to_values(item);
-      assert(!values.empty());
-      buffer_.push_back(std::move(values));
+    stats.record_success(source_name_, entity_->name, page_rows, latency_ms);
+    run_rows_ += static_cast<int64_t>(page_rows);
+    if (static_cast<int>(page_rows) >= request_limit_)
+      ++run_full_pages_;
+    page_size_.on_success(request_limit_, page_rows, page_bytes_, latency_ms);
+    stats.set_page_size(source_name_, entity_->name, page_size_.size());
+
+    if (page_rows == 0) {
+      --inflight_pages_;
+      MemoryBudget::instance().release(reserved_.back());
+      reserved_.pop_back();
+      request_finish();
+      return;
     }
 
-    if (buffer_.size() >= GRAPHQL_BATCH_SIZE) {
-      flush_buffer();
+    // 仅追加判定用发请求时的游标, 须在推进游标之前; 游标按未剔除的整页推进
+    std::vector<uint8_t> keep;
+    bool append = entity_->append_only && check_append();
+    if (merged_page_)
+      drop_duplicate_ids(start_row, page_rows, keep);
+    update_cursor(start_row, page_rows);
+    if (archive_) // 全量重拉分片写暂存表, 其游标不归档(重灌只 upsert 行)
+      archive_->write_page(source_name_, entity_->table, is_refresh_shard() ? "" : cursor_key_, cursor_);
+    bool last_page = static_cast<int>(page_rows) < request_limit_;
+
+    // 本页移入 staged_, buffer_ 腾给下一页解码(两者交换以复用容量)
+    assert(staged_.empty());
+    std::swap(buffer_, staged_);
+    if (!keep.empty())
+      staged_.retain(keep);
+    staged_cursor_ = cursor_;
+    staged_append_ = append;
+    // 预算由预估改为实际列缓冲大小(须在预取登记下一页之前)
+    MemoryBudget::instance().resize(reserved_.back(), staged_.byte_size());
+    reserved_.back() = staged_.byte_size();
+
+    // 预取: 下一页游标已确定, 先发请求再交写库线程落盘本页, 网络与写库并行
+    if (!last_page) {
+      if (inflight_pages_ < options_.pipeline_depth)
+        send_request_when_writable();
+      else
+        next_blocked_ = true;
     }
 
-    if (items.size() < GRAPHQL_BATCH_SIZE) {
-      if (!buffer_.empty())
-        flush_buffer();
-      finish_sync();
+    commit_page();
+
+    if (last_page)
+      request_finish();
+  }
+
+  // 写队列满或内存预算不足时暂停拉取, 有空位/额度后续发
+  // 按预估响应体积占用预算(扇出按片数放大), 解码后改为实际大小
+  void send_request_when_writable() {
+    if (writer_.full()) {
+      send_waiting_ = true;
+      writer_.on_ready([this]() {
+        send_waiting_ = false;
+        send_request_when_writable();
+      });
+      return;
+    }
+    size_t bytes = page_size_.estimate_bytes() * static_cast<size_t>(fanout_width());
+    auto &budget = MemoryBudget::instance();
+    if (!budget.try_acquire(bytes)) {
+      send_waiting_ = true;
+      budget.wait(bytes, [this, bytes]() {
+        send_waiting_ = false;
+        send_request(bytes);
+      });
       return;
     }
+    send_request(bytes);
+  }
+
+  // 写库失败后在途页全部回来时: 写线程解除本游标停写(FIFO 先于之后提交的页), 游标退回最后落盘处重拉
+  void recover_if_idle() {
+    if (inflight_pages_ > 0)
+      return;
+    writer_.resume_cursor(source_name_, cursor_key_);
+    cursor_ = committed_cursor_;
+    dense_ = false;
+    finish_pending_ = false;
+    write_failed_ = false;
+    if (!send_waiting_) // 已登记的续发会带上退回后的游标
+      pool_.schedule_retry([this]() { send_request_when_writable(); }, PULL_RETRY_MAX_DELAY_MS);
+  }
 
-    send_request();
+  // 追平: 本执行器已提交的页全部落盘后才结束(分片删游标行/换表依赖于此)
+  void request_finish() {
+    finish_pending_ = true;
+    if (writes_pending_ == 0)
+      finish_sync();
+  }
+
+  // 探测结果: 本实体最早一行的 order_field 值作为回填下界
+  void on_probe(size_t rows, size_t start_row) {
+    probing_ = false;
+    if (rows > 0)
+      plan_backfill(std::stoll(buffer_.cell_string(order_col_, start_row)));
+    buffer_.clear();
+    send_request_when_writable();
+  }
+
+  // [lo, now) 等宽切成 backfill_shards 段; 分片游标与尾部游标(now)同一事务写入(写线程, 先于任何分片页)
+  void plan_backfill(int64_t lo) {
+    int64_t hi = static_cast<int64_t>(std::time(nullptr));
+    int n = options_.backfill_shards;
+    if (hi - lo < n)
+      return;
+
+    std::vector<std::pair<std::string, SyncCursor>> cursors;
+    std::vector<ShardStart> shards;
+    for (int i = 0; i < n; ++i) {
+      int64_t b0 = lo + (hi - lo) * i / n;
+      int64_t b1 = (i == n - 1) ? hi : lo + (hi - lo) * (i + 1) / n;
+      shards.push_back({std::to_string(b1), SyncCursor{std::to_string(b0), 0, ""}});
+      cursors.push_back({shard::cursor_key(entity_->name, shard::BACKFILL, shards.back().first),
+                         shards.back().second});
+    }
+    cursor_ = SyncCursor{std::to_string(hi), 0, ""};
+    committed_cursor_ = cursor_;
+    cursors.push_back({cursor_key_, cursor_});
+    writer_.run_task([source = source_name_, cursors](Database &db) { db.put_cursors(source, cursors); });
+    if (archive_)
+      archive_->write_cursors(source_name_, cursors);
+
+    std::cout << "[Pull] " << source_name_ << "/" << entity_->name << " backfill planned: ["
+              << lo << ", " << hi << ") x " << n << " shards" << std::endl;
+    on_backfill_(shards);
   }
 
-  std::string build_query() {
-    std::string limit = std::to_string(GRAPHQL_BATCH_SIZE);
+  std::string build_query() { return R"({"query":"{)" + build_selection() + R"(}"})"; }
+
+  // 单个 entity 的查询字段: plural(args){fields}
+  std::string build_selection() { return build_selection(request_limit_, cursor_.skip); }
+
+  std::string build_selection(int first, int skip) {
+    std::string limit = std::to_string(first);
     std::string plural = entity_->plural;
     std::string fields = entity_->fields;
 
+    if (probing_) {
+      return plural + "(first:1,orderBy:" + entity_->order_field +
+             ",orderDirection:asc){" + fields + "}";
+    }
+
     if (entity_->sync_mode == entities::SyncMode::ID) {
-      if (cursor_value_.empty()) {
-        return R"({"query":"{)" + plural +
+      std::string where;
+      if (!cursor_.value.empty())
+        where = R"(id_gt:\")" + graphql::escape_json(cursor_.value) + R"(\")";
+      if (!shard_.hi.empty())
+        where += (where.empty() ? "" : ",") + std::string(R"(id_lt:\")") + graphql::escape_json(shard_.hi) + R"(\")";
+      if (where.empty()) {
+        return plural +
                "(first:" + limit + ",orderBy:id,orderDirection:asc){" +
-               fields + R"(}}"})";
+               fields + "}";
       }
-      return R"({"query":"{)" + plural +
-             R"((first:)" + limit + R"(,orderBy:id,orderDirection:asc,where:{id_gt:\")" +
-             graphql::escape_json(cursor_value_) + R"(\"}){)" +
-             fields + R"(}}"})";
+      return plural +
+             "(first:" + limit + ",orderBy:id,orderDirection:asc,where:{" + where + "}){" +
+             fields + "}";
+    }
+
+    std::string cv = cursor_.value.empty() ? "0" : cursor_.value;
+    // 分片上界, 追加到每个 where 对象内
+    std::string upper = shard_.hi.empty() ? "" : std::string(",") + entity_->order_field + "_lt:" + shard_.hi;
+
+    // KEYSET: (order_field, id) 复合游标, 边界时间戳内按 id 续接, 页成本与同时间戳行数无关
+    // 尚无边界 id(首次/旧 skip 游标迁移)时退回 gte + skip
+    if (entity_->sync_mode == entities::SyncMode::KEYSET && !cursor_.id.empty()) {
+      std::string order = entity_->order_field;
+      return plural +
+             "(first:" + limit + ",orderBy:" + order +
+             ",orderDirection:asc,where:{or:[{" + order + ":" + cv + R"(,id_gt:\")" +
+             graphql::escape_json(cursor_.id) + R"(\")" + upper + "},{" + order + "_gt:" + cv + upper + "}]}){" +
+             fields + "}";
     }
 
-    std::string cv = cursor_value_.empty() ? "0" : cursor_value_;
-    return R"({"query":"{)" + plural +
+    return plural +
            "(first:" + limit + ",orderBy:" + entity_->order_field +
-           ",orderDirection:asc,where:{" + entity_->where_field + ":" + cv +
-           "},skip:" + std::to_string(cursor_skip_) + "){" +
-           fields + R"(}}"})";
+           ",orderDirection:asc,where:{" + entity_->where_field + ":" + cv + upper +
+           "},skip:" + std::to_string(skip) + "){" +
+           fields + "}";
   }
 
-  void update_cursor(const json &items) {
-    assert(!items.empty());
+  // 本页位于 buffer_ 的 [first, first + n)
+  void update_cursor(size_t first, size_t n) {
+    assert(n > 0);
+    size_t last = first + n - 1;
+    dense_ = false;
 
     if (entity_->sync_mode == entities::SyncMode::ID) {
-      cursor_value_ = items.back()["id"].get<std::string>();
-      cursor_skip_ = 0;
+      cursor_.value = buffer_.cell_string(order_col_, last);
+      cursor_.skip = 0;
+      return;
+    }
+
+    if (entity_->sync_mode == entities::SyncMode::KEYSET) {
+      cursor_.value = buffer_.cell_string(order_col_, last);
+      cursor_.id = buffer_.cell_string(id_col_, last);
+      cursor_.skip = 0;
       return;
     }
 
-    const char *order_field = entity_->order_field;
-    auto extract_value = [&](const json &item) -> std::string {
-      auto &val = item[order_field];
-      if (val.is_null())
-        return "";
-      if (val.is_string())
-        return val.get<std::string>();
-      if (val.is_number())
-        return std::to_string(val.get<int64_t>());
-      return val.dump();
-    };
-
-    std::string last_val = extract_value(items.back());
-
-    if (static_cast<int>(items.size()) < GRAPHQL_BATCH_SIZE) {
-      cursor_value_ = last_val;
-      cursor_skip_ = 0;
-    } else if (last_val == cursor_value_) {
-      cursor_skip_ += GRAPHQL_BATCH_SIZE;
+    std::string last_val = buffer_.cell_string(order_col_, last);
+
+    if (static_cast<int>(n) < request_limit_) {
+      cursor_.value = last_val;
+      cursor_.skip = 0;
+    } else if (last_val == cursor_.value) {
+      cursor_.skip += static_cast<int>(n);
     } else {
-      cursor_value_ = last_val;
-      cursor_skip_ = 0;
-      for (auto it = items.rbegin(); it != items.rend(); ++it) {
-        if (extract_value(*it) == last_val)
-          ++cursor_skip_;
+      cursor_.value = last_val;
+      cursor_.skip = 0;
+      for (size_t r = last + 1; r-- > first;) {
+        if (buffer_.cell_equals(order_col_, r, last))
+          ++cursor_.skip;
         else
           break;
       }
     }
+    // 整页都在游标时间戳上: 热点时间戳, 下一页起扇出
+    dense_ = cursor_.skip >= static_cast<int>(n);
   }
 
-  void flush_buffer() {
-    assert(!buffer_.empty());
-    db_.atomic_insert_with_cursor(entity_->table, entity_->columns, buffer_,
-                                  source_name_, entity_->name,
-                                  cursor_value_, cursor_skip_);
-    buffer_.clear();
+  // 仅追加: 只有 KEYSET 续接页(id_gt)保证不与已落盘行重叠; 其余页(gte/skip、重启后首页)走 upsert
+  bool check_append() const {
+    return entity_->sync_mode == entities::SyncMode::KEYSET && !cursor_.id.empty();
   }
 
-  void parse_indexer_errors(const json &errors, StatsManager &stats) {
-    if (!errors.is_array())
-      return;
-    for (auto &err : errors) {
-      if (!err.contains("message") || !err["message"].is_string())
+  // 扇出拼接页: 片间请求之间有新行插入时 skip 偏移会重叠, 同一 id 出现两次(同一 upsert 语句不能有重复键);
+  // 只剔除落盘的行, 游标仍按整页推进
+  void drop_duplicate_ids(size_t first, size_t n, std::vector<uint8_t> &keep) {
+    std::unordered_set<std::string> seen;
+    for (size_t r = first; r < first + n; ++r) {
+      if (!keep.empty() && !keep[r])
         continue;
-      const std::string msg = err["message"].get<std::string>();
+      if (!seen.insert(buffer_.cell_string(id_col_, r)).second) {
+        if (keep.empty())
+          keep.assign(buffer_.size(), 1);
+        keep[r] = 0;
+      }
+    }
+  }
+
+  // 本页数据 + 游标快照交写库线程同一事务落盘; 队列 FIFO, 游标单调推进
+  // 仅追加页剔除重叠后可能为空, 此时只推进游标
+  void commit_page() {
+    ++writes_pending_;
+    writer_.submit({table_, entity_->columns, std::move(staged_), source_name_, cursor_key_, staged_cursor_,
+                    staged_append_},
+                   [this, cursor = staged_cursor_](ColumnBatch &&batch, bool ok) {
+                     on_page_committed(std::move(batch), ok, cursor);
+                   });
+    if (spare_.empty()) {
+      staged_ = ColumnBatch(entity_);
+      staged_.reserve(options_.max_page_size);
+    } else {
+      staged_ = std::move(spare_.back());
+      spare_.pop_back();
+    }
+  }
+
+  // 写库线程提交完成(io 线程): 页缓冲回收复用, 释放在途名额
+  // ok=false: 本页未落盘, 写线程对本游标停写; 之后的页不再推进游标
+  void on_page_committed(ColumnBatch &&batch, bool ok, const SyncCursor &cursor) {
+    spare_.push_back(std::move(batch));
+    --writes_pending_;
+    --inflight_pages_;
+    MemoryBudget::instance().release(reserved_.front());
+    reserved_.pop_front();
+
+    if (ok && !write_failed_)
+      committed_cursor_ = cursor;
+    if (!ok && !write_failed_) {
+      write_failed_ = true;
+      std::cerr << "[Pull] " << source_name_ << "/" << cursor_key_
+                << " page write failed, refetching from last committed cursor" << std::endl;
+    }
+    if (write_failed_) {
+      next_blocked_ = false;
+      recover_if_idle();
+      return;
+    }
+
+    if (next_blocked_) {
+      next_blocked_ = false;
+      send_request_when_writable();
+    }
+    if (finish_pending_ && writes_pending_ == 0)
+      finish_sync();
+  }
+
+  void parse_indexer_errors(const std::vector<std::string> &messages, StatsManager &stats) {
+    for (const auto &msg : messages) {
       auto p = msg.find("bad indexers:");
       if (p == std::string::npos)
         continue;
@@ -282,29 +753,91 @@ private:
     int delay = PULL_RETRY_DELAY_MS * (1 << std::min(retry_count_, 10));
     delay = std::min(delay, PULL_RETRY_MAX_DELAY_MS);
     ++retry_count_;
-    std::cerr << "[Pull] " << entity_->name << " " << reason
+    std::cerr << "[Pull] " << cursor_key_ << " " << reason
               << ", retry " << retry_count_ << " in " << delay << "ms" << std::endl;
-    pool_.schedule_retry([this]() { send_request(); }, delay);
+    pool_.schedule_retry([this]() { send_page_request(); }, delay);
   }
 
   void finish_sync() {
+    finish_pending_ = false;
+    if (is_shard()) {
+      // 分片已追平: 删除游标行(写线程), 删除落盘后才算完成, 分片计数由调度器维护
+      if (archive_ && !is_refresh_shard())
+        archive_->write_cursors(source_name_, {}, {cursor_key_});
+      writer_.run_task([source = source_name_, key = cursor_key_](Database &db) { db.delete_cursor(source, key); },
+                       [this]() { mark_done(); });
+      return;
+    }
     StatsManager::instance().end_sync(source_name_, entity_->name);
-    std::cout << "[Pull] " << source_name_ << "/" << entity_->name << " done" << std::endl;
+    mark_done();
+  }
+
+  void mark_done() {
+    std::cout << "[Pull] " << source_name_ << "/" << cursor_key_ << " done" << std::endl;
     done_ = true;
     on_done_();
   }
 
   std::string source_name_;
   const entities::EntityDef *entity_;
+  EntityOptions options_;
   Database &db_;
   HttpsPool &pool_;
+  IngestWriter &writer_;
   DoneCallback on_done_;
+  BackfillCallback on_backfill_;
   std::string target_;
-
-  std::string cursor_value_;
-  int cursor_skip_ = 0;
-  std::vector<std::string> buffer_;
+  ShardSpec shard_;
+  std::string cursor_key_; // sync_state.entity 列
+  std::string table_;      // 落盘表(REFRESH 分片写暂存表)
+
+  SyncCursor cursor_;
+  SyncCursor committed_cursor_; // 最后一页已落盘时的游标(写库失败时退回)
+  bool write_failed_ = false;   // 有页写库失败, 等在途页回来后退回重拉
+  bool send_waiting_ = false;   // 有登记中的续发(写队列满/内存预算不足)
+  bool cursor_loaded_ = false;
+  ColumnBatch buffer_;        // 当前页解码目标
+  ColumnBatch staged_;        // 待交写库线程的页
+  std::vector<ColumnBatch> spare_; // 写库线程交还的页缓冲(复用容量)
+  SyncCursor staged_cursor_;  // 待落盘页对应的游标
+  bool staged_append_ = false; // 待落盘页可纯 INSERT
+  int order_col_;
+  int id_col_;
+  graphql::PageDecoder decoder_;
+  bool hedge_decoded_ = false; // 在途请求走了对冲: 已在 accept 中整包解码
+  graphql::PageStatus hedge_status_ = graphql::PageStatus::OK;
+  PageBatcher *batcher_ = nullptr; // 非空 = 合批模式
+  PageArchive *archive_ = nullptr; // 非空 = 归档响应
+  std::string page_body_;          // 归档: 在途请求的响应 body
+  PageSizeController page_size_;
+  int request_limit_ = 0;     // 在途请求的 first: (扇出时为各片之和)
+  size_t page_bytes_ = 0;     // 在途请求已收响应字节
+  int inflight_pages_ = 0;    // 已请求未落盘的页数 (<= pipeline_depth)
+  std::deque<size_t> reserved_; // 各在途页占用的内存预算字节, 顺序同落盘
+  bool next_blocked_ = false; // 下一页因在途上限被推迟, 落盘后补发
+  int writes_pending_ = 0;    // 已交写库线程未完成的页数
+  bool finish_pending_ = false; // 已追平, 等待在写的页落盘后结束
+  bool probing_ = false;     // 正在探测回填下界(first:1 请求)
+  bool dense_ = false;       // gte + skip: 上一页整页同一时间戳
+
+  // 热点时间戳扇出的一片: 独立解码缓冲(跨组复用)
+  struct FanoutSlot {
+    explicit FanoutSlot(const entities::EntityDef *entity) : rows(entity) {}
+    graphql::PageDecoder decoder;
+    ColumnBatch rows;
+    std::string body; // 归档
+    size_t bytes = 0;
+    bool success = false;
+    bool decoded = false; // 对冲: 已在 accept 中整包解码, status 即结果
+    graphql::PageStatus status = graphql::PageStatus::OK;
+  };
+  std::vector<std::unique_ptr<FanoutSlot>> fanout_;
+  int fanout_pending_ = 0; // 扇出组未返回的片数
+  bool merged_page_ = false; // on_page 正在处理扇出拼接页
+  int slot_limit_ = 0;     // 扇出组每片的 first:
   bool done_ = false;
+  int64_t run_rows_ = 0;
+  int run_full_pages_ = 0;
   std::chrono::steady_clock::time_point request_start_;
   int retry_count_ = 0;
 };
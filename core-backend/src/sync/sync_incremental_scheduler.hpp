@@ -4,22 +4,34 @@
 // 小sync - Source调度器（中间层，依赖 Executor）
 // ============================================================================
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
 #include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../core/config.hpp"
 #include "../core/database.hpp"
 #include "../core/entity_definition.hpp"
+#include "../core/ingest_writer.hpp"
 #include "../infra/https_pool.hpp"
 #include "../stats/stats_manager.hpp"
+#include "page_batcher.hpp"
 #include "sync_incremental_executor.hpp"
 
 #define PARALLEL_PER_SOURCE 9999
+#define SYNC_POLL_MIN_MS 1000 // 持续模式最短轮询间隔(上限为 sync_interval_seconds)
 
 // ============================================================================
 // SyncIncrementalScheduler - 单个 source 的调度器
+// 调度器与执行器跨轮次常驻: DDL / 表行数 / 统计 / 游标只在构造(进程启动)时读库, 之后以内存为准
+//   轮次模式: 全部执行器完成后回调 on_done, 协调器间隔后再次 start()
+//   持续模式: 尾部执行器完成后按自身结果退避再启动, 分片执行器完成即回收, 不回调 on_done
 // ============================================================================
 class SyncIncrementalScheduler {
 public:
@@ -27,12 +39,15 @@ public:
   using SlotAcquireFunc = std::function<bool()>;
   using SlotReleaseFunc = std::function<void()>;
 
-  SyncIncrementalScheduler(const SourceConfig &config, Database &db, HttpsPool &pool,
-                           SlotAcquireFunc try_acquire, SlotReleaseFunc release, DoneCallback on_done)
-      : source_name_(config.name), db_(db), pool_(pool),
+  SyncIncrementalScheduler(const SourceConfig &config, Database &db, HttpsPool &pool, IngestWriter &writer,
+                           SlotAcquireFunc try_acquire, SlotReleaseFunc release, DoneCallback on_done,
+                           bool continuous = false, int max_poll_seconds = 60, PageArchive *archive = nullptr)
+      : source_name_(config.name), subgraph_id_(config.subgraph_id), db_(db), pool_(pool), writer_(writer),
+        archive_(archive),
         try_acquire_slot_(std::move(try_acquire)),
         release_slot_(std::move(release)),
-        on_done_(std::move(on_done)) {
+        on_done_(std::move(on_done)), continuous_(continuous),
+        max_poll_ms_(std::max(SYNC_POLL_MIN_MS, max_poll_seconds * 1000)) {
 
     for (const auto &entity_name : config.entities) {
       auto it = config.entity_table_map.find(entity_name);
@@ -46,13 +61,46 @@ public:
       int64_t row_size_bytes = entities::estimate_row_size_bytes(e);
       StatsManager::instance().init(source_name_, e->name, count, row_size_bytes);
 
-      executors_.emplace_back(config.subgraph_id, source_name_, e, db_, pool_,
-                              [this]() { on_executor_done(); });
+      const auto &options = config.entity_options_map.at(entity_name);
+      if (options.backfill_shards > 1 && e->sync_mode == entities::SyncMode::KEYSET) {
+        // 上次未完成的回填分片: 按残留游标行恢复
+        std::vector<SyncIncrementalExecutor::ShardStart> shards;
+        for (const auto &[key, cursor] :
+             db_.get_cursors_with_prefix(source_name_, shard::key_prefix(e->name, shard::BACKFILL)))
+          shards.push_back({shard::hi_from_key(e->name, shard::BACKFILL, key), cursor});
+        add_backfill_shards(e, options, shards);
+
+        add_tail_executor(e, options, [this, e, options](const std::vector<SyncIncrementalExecutor::ShardStart> &planned) {
+          add_backfill_shards(e, options, planned);
+          start_next();
+        });
+      } else if (options.refresh_shards > 1 && e->sync_mode == entities::SyncMode::ID) {
+        // 全量重拉取代 id_gt 单游标: 每轮 start() 检查是否到期, 未到期的轮次不拉该 entity
+        load_refresh_state(e, options);
+      } else {
+        add_tail_executor(e, options);
+      }
+    }
+
+    // 合批: 尾部执行器共用一个 batcher(同一 subgraph), 分片执行器页大仍单独请求
+    if (config.batch) {
+      batcher_ = std::make_unique<PageBatcher>(pool_, graphql::build_target(subgraph_id_), source_name_, archive_);
+      for (auto &ex : executors_) {
+        if (!ex->is_shard())
+          ex->set_batcher(batcher_.get());
+      }
     }
   }
 
+  // 每轮(持续模式仅一次)调用: 回收上一轮完成的分片执行器, 尾部执行器从内存游标续拉
   void start() {
-    std::cout << "[Scheduler] " << source_name_ << " start, " << executors_.size() << " entities" << std::endl;
+    compact_executors();
+    next_idx_ = 0;
+    done_count_ = 0;
+    for (auto &[name, rs] : refresh_)
+      plan_refresh(rs.entity);
+
+    std::cout << "[Scheduler] " << source_name_ << " start, " << executors_.size() << " executors" << std::endl;
     if (executors_.empty()) {
       on_done_();
       return;
@@ -65,11 +113,216 @@ public:
   int active_count() const { return active_count_; }
 
 private:
+  struct Tail {
+    SyncIncrementalExecutor *executor;
+    int poll_ms; // 持续模式下次轮询间隔
+  };
+
+  struct RefreshState {
+    const entities::EntityDef *entity;
+    EntityOptions options;
+    std::vector<SyncIncrementalExecutor::ShardStart> resume; // 启动时残留的分片(上次未完成)
+    int64_t last_done = 0;               // 上次换表时间(unix 秒), 0 = 从未完成
+    int pending = 0;                     // 本次未完成的分片数
+    std::chrono::steady_clock::time_point started;
+  };
+
+  void add_tail_executor(const entities::EntityDef *e, const EntityOptions &options,
+                         SyncIncrementalExecutor::BackfillCallback on_backfill = {}) {
+    size_t t = tails_.size();
+    executors_.push_back(std::make_unique<SyncIncrementalExecutor>(
+        subgraph_id_, source_name_, e, options, db_, pool_, writer_,
+        [this, t]() { on_tail_done(t); }, ShardSpec{}, std::move(on_backfill)));
+    executors_.back()->set_archive(archive_);
+    tails_.push_back({executors_.back().get(), SYNC_POLL_MIN_MS});
+  }
+
+  // 持续模式: 有满页(仍在追赶)→ 最短间隔; 有新行 → 间隔减半; 空轮 → 间隔翻倍至上限
+  void on_tail_done(size_t t) {
+    if (!continuous_) {
+      on_executor_done();
+      return;
+    }
+    --active_count_;
+    release_slot_();
+
+    auto &tail = tails_[t];
+    if (tail.executor->run_full_pages() > 0)
+      tail.poll_ms = SYNC_POLL_MIN_MS;
+    else if (tail.executor->run_rows() > 0)
+      tail.poll_ms = std::max(SYNC_POLL_MIN_MS, tail.poll_ms / 2);
+    else
+      tail.poll_ms = std::min(max_poll_ms_, tail.poll_ms * 2);
+    pool_.schedule_retry([this, t]() { restart_tail(t); }, tail.poll_ms);
+  }
+
+  void restart_tail(size_t t) {
+    if (!try_acquire_slot_()) {
+      pool_.schedule_retry([this, t]() { restart_tail(t); }, SYNC_POLL_MIN_MS);
+      return;
+    }
+    ++active_count_;
+    tails_[t].executor->start();
+  }
+
+  // 已完成的分片执行器回收(持续模式延后一个 tick 调用, 其 on_done 调用栈尚未返回)
+  void compact_executors() {
+    size_t before = executors_.size();
+    std::erase_if(executors_, [](const auto &ex) { return ex->is_shard() && ex->is_done(); });
+    next_idx_ -= before - executors_.size(); // 完成的必然已启动, 位于 next_idx_ 之前
+  }
+
+  // 每个分片一个执行器, 与其它 entity 一起经 HttpsPool 并发拉取
+  void add_backfill_shards(const entities::EntityDef *e, const EntityOptions &options,
+                           const std::vector<SyncIncrementalExecutor::ShardStart> &shards) {
+    if (shards.empty())
+      return;
+    for (const auto &[hi, cursor] : shards) {
+      executors_.push_back(std::make_unique<SyncIncrementalExecutor>(
+          subgraph_id_, source_name_, e, options, db_, pool_, writer_,
+          [this, e]() {
+            StatsManager::instance().finish_backfill_shard(source_name_, e->name);
+            on_executor_done();
+          },
+          ShardSpec{shard::cursor_key(e->name, shard::BACKFILL, hi), hi, ""}));
+      executors_.back()->set_archive(archive_);
+      executors_.back()->set_cursor(cursor);
+    }
+    StatsManager::instance().set_backfill_shards(source_name_, e->name, static_cast<int>(shards.size()));
+    std::cout << "[Scheduler] " << source_name_ << "/" << e->name << " backfill "
+              << shards.size() << " shards" << std::endl;
+  }
+
+  // 启动时读取重拉状态: 残留分片行 + 上次完成时间
+  void load_refresh_state(const entities::EntityDef *e, const EntityOptions &options) {
+    RefreshState rs{e, options, {}, 0, 0, {}};
+    for (const auto &[key, cursor] :
+         db_.get_cursors_with_prefix(source_name_, shard::key_prefix(e->name, shard::REFRESH)))
+      rs.resume.push_back({shard::hi_from_key(e->name, shard::REFRESH, key), cursor});
+    auto last = db_.get_cursor(source_name_, refresh_done_key(e));
+    if (!last.value.empty())
+      rs.last_done = std::stoll(last.value);
+    refresh_.emplace(e->name, std::move(rs));
+  }
+
+  // ID 模式全量重拉: 到期(或有残留分片)时按 id 十六进制前缀切 K 段,
+  // 各段 [lo, hi) 并发写入暂存表, 全部完成后与正式表原子交换
+  // 暂存表 DDL 与分片游标走写线程, FIFO 保证先于分片的页落盘
+  void plan_refresh(const entities::EntityDef *e) {
+    auto &rs = refresh_.at(e->name);
+    const auto &options = rs.options;
+    std::string staging = std::string(e->table) + "__refresh";
+    std::vector<SyncIncrementalExecutor::ShardStart> shards = std::move(rs.resume);
+    rs.resume.clear();
+
+    if (!shards.empty()) {
+      writer_.run_task([e, staging](Database &db) { db.ensure_staging_table(e, staging); }); // 上次未完成: 续拉
+    } else {
+      int64_t now = static_cast<int64_t>(std::time(nullptr));
+      if (rs.last_done != 0 && now - rs.last_done < options.refresh_interval_seconds) {
+        if (continuous_)
+          schedule_refresh(e, options.refresh_interval_seconds - (now - rs.last_done));
+        return;
+      }
+
+      std::vector<std::pair<std::string, SyncCursor>> cursors;
+      int k = options.refresh_shards;
+      for (int i = 0; i < k; ++i) {
+        // 首段无下界、末段无上界, 兜住非 0x 小写十六进制的 id
+        std::string lo = (i == 0) ? "" : hex_prefix(256 * i / k);
+        std::string hi = (i == k - 1) ? "" : hex_prefix(256 * (i + 1) / k);
+        shards.push_back({hi, SyncCursor{lo, 0, ""}});
+        cursors.push_back({shard::cursor_key(e->name, shard::REFRESH, hi), shards.back().second});
+      }
+      writer_.run_task([e, staging, source = source_name_, cursors](Database &db) {
+        db.recreate_staging_table(e, staging);
+        db.put_cursors(source, cursors);
+      });
+    }
+
+    rs.pending = static_cast<int>(shards.size());
+    rs.started = std::chrono::steady_clock::now();
+    for (const auto &[hi, cursor] : shards) {
+      executors_.push_back(std::make_unique<SyncIncrementalExecutor>(
+          subgraph_id_, source_name_, e, options, db_, pool_, writer_,
+          [this, e, staging]() {
+            on_refresh_shard_done(e, staging);
+            on_executor_done();
+          },
+          ShardSpec{shard::cursor_key(e->name, shard::REFRESH, hi), hi, staging}));
+      executors_.back()->set_archive(archive_);
+      executors_.back()->set_cursor(cursor);
+    }
+    StatsManager::instance().set_refresh_shards(source_name_, e->name, static_cast<int>(shards.size()));
+    std::cout << "[Scheduler] " << source_name_ << "/" << e->name << " full refresh "
+              << shards.size() << " shards → " << staging << std::endl;
+  }
+
+  // 持续模式: 下一次全量重拉由定时器触发(轮次模式每轮 start() 检查)
+  void schedule_refresh(const entities::EntityDef *e, int64_t seconds) {
+    pool_.schedule_retry(
+        [this, e]() {
+          plan_refresh(e);
+          start_next();
+        },
+        static_cast<int>(std::max<int64_t>(seconds, 1) * 1000));
+  }
+
+  void on_refresh_shard_done(const entities::EntityDef *e, const std::string &staging) {
+    auto &stats = StatsManager::instance();
+    stats.finish_refresh_shard(source_name_, e->name);
+    auto &rs = refresh_.at(e->name);
+    if (--rs.pending > 0)
+      return;
+
+    rs.last_done = static_cast<int64_t>(std::time(nullptr));
+    // 换表后行数以新表为准(每个重拉周期一次): COUNT(*) 也在写线程做完再交回 io 线程
+    auto count = std::make_shared<int64_t>(0);
+    writer_.run_task(
+        [e, staging, count, source = source_name_,
+         cursor = SyncCursor{std::to_string(rs.last_done), 0, ""}](Database &db) {
+          db.swap_staging_table(e->table, staging, source, refresh_done_key(e), cursor);
+          *count = db.get_table_count(e->table);
+        },
+        [this, e, count]() { on_refresh_swapped(e, *count); });
+  }
+
+  void on_refresh_swapped(const entities::EntityDef *e, int64_t count) {
+    auto &stats = StatsManager::instance();
+    auto &rs = refresh_.at(e->name);
+    stats.set_count(source_name_, e->name, count);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - rs.started)
+                  .count();
+    std::cout << "[Scheduler] " << source_name_ << "/" << e->name << " full refresh swapped in, "
+              << count << " rows, " << ms << "ms" << std::endl;
+    if (continuous_)
+      schedule_refresh(e, rs.options.refresh_interval_seconds);
+  }
+
+  // sync_state 中记录上次全量重拉完成时间(cursor_value = unix 秒)
+  static std::string refresh_done_key(const entities::EntityDef *e) {
+    return std::string(e->name) + "@refresh";
+  }
+
+  static std::string hex_prefix(int byte) {
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "0x%02x", byte);
+    return buf;
+  }
+
   void on_executor_done() {
     ++done_count_;
     --active_count_;
     release_slot_();
 
+    if (continuous_) {
+      pool_.post([this]() { compact_executors(); });
+      start_next();
+      return;
+    }
+
     if (all_done()) {
       on_done_();
       return;
@@ -82,20 +335,29 @@ private:
     while (next_idx_ < executors_.size() &&
            active_count_ < PARALLEL_PER_SOURCE &&
            try_acquire_slot_()) {
-      executors_[next_idx_].start();
+      executors_[next_idx_]->start();
       ++active_count_;
       ++next_idx_;
     }
   }
 
   std::string source_name_;
+  std::string subgraph_id_;
   Database &db_;
   HttpsPool &pool_;
+  IngestWriter &writer_;
+  PageArchive *archive_; // 非空 = 归档响应
   SlotAcquireFunc try_acquire_slot_;
   SlotReleaseFunc release_slot_;
   DoneCallback on_done_;
+  bool continuous_;
+  int max_poll_ms_;
 
-  std::vector<SyncIncrementalExecutor> executors_;
+  std::unique_ptr<PageBatcher> batcher_; // 合批模式(执行器持有指针, 需地址稳定)
+  // 回填分片在运行中追加, 需地址稳定
+  std::vector<std::unique_ptr<SyncIncrementalExecutor>> executors_;
+  std::vector<Tail> tails_; // 尾部执行器(构造时确定, 不回收)
+  std::unordered_map<std::string, RefreshState> refresh_; // entity → 全量重拉状态
   size_t next_idx_ = 0;
   int active_count_ = 0;
   int done_count_ = 0;
@@ -3,19 +3,26 @@
 // ============================================================================
 // Token ID Filler - 填充 condition.positionIds
 // 1. bulk merge pnl_condition → condition (幂等)
-// 2. 按 resolutionTimestamp 顺序逐批查 PnL subgraph 填充剩余 NULL
+// 2. 一次取出剩余 NULL id (按 resolutionTimestamp 顺序), 切成 id_in 批, 流水线填充:
+//    - 请求在 HttpsPool 的 io 线程发出/重试, 同时保持 TOKEN_FILL_INFLIGHT 批在途
+//    - 工作线程收结果: 解析后整批经 QueryAppender 暂存, 一条 UPDATE…FROM 连接写回
+//      (PnL subgraph 也没有的 id 同批写 "[]", 防死循环); 写库期间其余批仍在途
 // ============================================================================
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
-#include <set>
 #include <string>
 #include <thread>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "../core/config.hpp"
@@ -25,6 +32,13 @@
 
 using json = nlohmann::json;
 
+// ============================================================================
+// 宏配置
+// ============================================================================
+#define TOKEN_FILL_BATCH 100       // 每个 id_in 请求的 id 数
+#define TOKEN_FILL_INFLIGHT 8      // 同时在途的批数
+#define TOKEN_FILL_RETRY_MS 1000   // 失败批的重发延迟
+
 class SyncTokenFiller {
 public:
   SyncTokenFiller(Database &db, HttpsPool &pool, const Config &config)
@@ -65,6 +79,14 @@ public:
   int64_t start_ts() const { return start_ts_; }
 
 private:
+  // 一个 id_in 批; 工作线程建好后只读, 响应体由 io 线程回填
+  struct Batch {
+    std::vector<std::string> ids;
+    std::string query;
+    std::string response;
+  };
+  using BatchPtr = std::shared_ptr<Batch>;
+
   void run() {
     start_ts_ = std::chrono::duration_cast<std::chrono::seconds>(
                     std::chrono::system_clock::now().time_since_epoch())
@@ -83,68 +105,35 @@ private:
     std::cout << "[TokenFiller] Phase 1 done: merged " << merged_
               << ", remaining " << after_merge << std::endl;
 
-    // Phase 2: 逐批填充剩余 NULL
+    // Phase 2: 流水线填充剩余 NULL
     phase_ = 2;
-    std::cout << "[TokenFiller] Phase 2: 填充剩余 " << after_merge << " NULL positionIds" << std::endl;
-    while (true) {
-      auto ids = db_.get_null_positionid_conditions(100);
-      if (ids.empty())
-        break;
-
-      // 构建 id_in 查询
-      std::string id_list;
-      for (size_t i = 0; i < ids.size(); ++i) {
-        if (i > 0)
-          id_list += ",";
-        id_list += "\\\"" + graphql::escape_json(ids[i]) + "\\\"";
-      }
-
-      std::string query = R"({"query":"{conditions(first:100,where:{id_in:[)" +
-                          id_list + R"(]}){id positionIds}}"})";
-
-      std::string response = sync_request(query);
-      if (response.empty()) {
-        ++errors_;
-        std::cerr << "[TokenFiller] network failure, retrying..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        continue;
+    auto ids = db_.get_null_positionid_conditions();
+    std::cout << "[TokenFiller] Phase 2: 填充剩余 " << ids.size() << " NULL positionIds, "
+              << TOKEN_FILL_INFLIGHT << " 批在途" << std::endl;
+
+    size_t next = 0;
+    int inflight = 0;
+    while (next < ids.size() || inflight > 0) {
+      while (inflight < TOKEN_FILL_INFLIGHT && next < ids.size()) {
+        size_t end = std::min(ids.size(), next + TOKEN_FILL_BATCH);
+        dispatch(make_batch(ids, next, end), 0);
+        next = end;
+        ++inflight;
       }
 
-      json j;
-      try {
-        j = json::parse(response);
-      } catch (...) {
-        ++errors_;
-        std::cerr << "[TokenFiller] JSON parse failure, retrying..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        continue;
+      std::deque<BatchPtr> done;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !completed_.empty(); });
+        done.swap(completed_);
       }
-
-      if (j.contains("errors") || !j.contains("data") || !j["data"].contains("conditions")) {
-        ++errors_;
-        std::cerr << "[TokenFiller] GraphQL error, retrying..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        continue;
-      }
-
-      auto &items = j["data"]["conditions"];
-
-      // 更新找到的
-      std::set<std::string> found_ids;
-      for (const auto &item : items) {
-        std::string id = item["id"].get<std::string>();
-        found_ids.insert(id);
-        if (item.contains("positionIds") && !item["positionIds"].is_null()) {
-          db_.update_condition_position_ids(id, item["positionIds"].dump());
-          ++processed_;
-        }
-      }
-
-      // PnL subgraph 也没有的 → 标记空数组，防死循环
-      for (const auto &id : ids) {
-        if (found_ids.find(id) == found_ids.end()) {
-          db_.update_condition_position_ids(id, "[]");
-          ++not_found_;
+      for (auto &batch : done) {
+        if (apply(*batch)) {
+          --inflight;
+        } else {
+          ++errors_;
+          batch->response.clear();
+          dispatch(batch, TOKEN_FILL_RETRY_MS);
         }
       }
     }
@@ -157,29 +146,94 @@ private:
     running_ = false;
   }
 
-  // 同步等待异步请求
-  std::string sync_request(const std::string &query) {
-    std::mutex mtx;
-    std::condition_variable cv;
-    std::string result;
-    bool done = false;
-
-    pool_.async_post(pnl_target_, query, [&](std::string body) {
-      std::lock_guard<std::mutex> lock(mtx);
-      result = std::move(body);
-      done = true;
-      cv.notify_one();
+  static BatchPtr make_batch(const std::vector<std::string> &ids, size_t begin, size_t end) {
+    auto batch = std::make_shared<Batch>();
+    batch->ids.assign(ids.begin() + static_cast<std::ptrdiff_t>(begin), ids.begin() + static_cast<std::ptrdiff_t>(end));
+    std::string id_list;
+    for (size_t i = 0; i < batch->ids.size(); ++i) {
+      if (i > 0)
+        id_list += ",";
+      id_list += "\\\"" + graphql::escape_json(batch->ids[i]) + "\\\"";
+    }
+    batch->query = R"({"query":"{conditions(first:)" + std::to_string(batch->ids.size()) +
+                   R"(,where:{id_in:[)" + id_list + R"(]}){id positionIds}}"})";
+    return batch;
+  }
+
+  // 工作线程调用: 请求一律转到 io 线程发出(HttpsPool 非线程安全), 完成后交回工作线程
+  void dispatch(BatchPtr batch, int delay_ms) {
+    pool_.post([this, batch = std::move(batch), delay_ms]() mutable {
+      auto send = [this, batch]() {
+        pool_.async_post(pnl_target_, batch->query, [this, batch](std::string body) {
+          batch->response = std::move(body);
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            completed_.push_back(batch);
+          }
+          cv_.notify_one();
+        });
+      };
+      if (delay_ms > 0)
+        pool_.schedule_retry(std::move(send), delay_ms);
+      else
+        send();
     });
+  }
+
+  // 解析一批响应并写库; 网络/解析/GraphQL 错误或写库失败返回 false(由调用方重发)
+  bool apply(const Batch &batch) {
+    if (batch.response.empty()) {
+      std::cerr << "[TokenFiller] network failure, retrying..." << std::endl;
+      return false;
+    }
+    json j;
+    try {
+      j = json::parse(batch.response);
+    } catch (...) {
+      std::cerr << "[TokenFiller] JSON parse failure, retrying..." << std::endl;
+      return false;
+    }
+    if (j.contains("errors") || !j.contains("data") || !j["data"].contains("conditions")) {
+      std::cerr << "[TokenFiller] GraphQL error, retrying..." << std::endl;
+      return false;
+    }
 
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.wait(lock, [&] { return done; });
-    return result;
+    std::vector<std::pair<std::string, std::string>> rows;
+    std::unordered_set<std::string> found_ids;
+    int64_t filled = 0;
+    for (const auto &item : j["data"]["conditions"]) {
+      std::string id = item["id"].get<std::string>();
+      if (item.contains("positionIds") && !item["positionIds"].is_null()) {
+        rows.emplace_back(id, item["positionIds"].dump());
+        ++filled;
+      }
+      found_ids.insert(std::move(id));
+    }
+    // PnL subgraph 也没有的 → 标记空数组，防死循环
+    int64_t missing = 0;
+    for (const auto &id : batch.ids) {
+      if (!found_ids.contains(id)) {
+        rows.emplace_back(id, "[]");
+        ++missing;
+      }
+    }
+
+    if (!db_.apply_position_ids(rows))
+      return false;
+    processed_ += filled;
+    not_found_ += missing;
+    return true;
   }
 
   Database &db_;
   HttpsPool &pool_;
   std::string pnl_target_;
 
+  // io 线程 → 工作线程: 已收到响应的批
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<BatchPtr> completed_;
+
   std::atomic<bool> running_{false};
   std::atomic<int64_t> processed_{0};
   std::atomic<int> phase_{0};        // 0=idle, 1=merge, 2=fill
@@ -49,6 +49,24 @@ async def api_entity_stats():
     return backend_get("/api/entity-stats")
 
 
+@app.get("/api/pool-stats")
+async def api_pool_stats():
+    """API: 获取 HTTPS 连接池统计"""
+    return backend_get("/api/pool-stats")
+
+
+@app.get("/api/writer-stats")
+async def api_writer_stats():
+    """API: 获取写库线程统计"""
+    return backend_get("/api/writer-stats")
+
+
+@app.get("/api/memory-stats")
+async def api_memory_stats():
+    """API: 获取 sync 内存预算统计"""
+    return backend_get("/api/memory-stats")
+
+
 @app.get("/api/entity-latest")
 async def api_entity_latest(entity: str = Query(...)):
     """API: 获取某个 entity 最近一条记录(用于 hover)"""